@@ -1,129 +1,306 @@
 import sqlite3
-import requests
+import socket
+import struct
 import time
+import asyncio
+import aiohttp
 from datetime import datetime
 import signal
 import sys
 import logging
-from threading import Event, Thread
+from threading import Event, Lock, Thread
 from collections import defaultdict
 
 logging.basicConfig(level=logging.INFO,
                    format='%(asctime)s - %(levelname)s - %(message)s')
 
+# Packed record layout used by the firmware's binary wire format
+# (Accept: application/octet-stream): little-endian int16 centi-degrees,
+# int16 centi-percent RH, uint32 seconds-since-boot timestamp.
+BINARY_RECORD = struct.Struct('<hhI')
+
+# Beacon datagram sent by nodes built with CONFIG_BEACON_MODE: sequence
+# number, node id (last two MAC bytes), centi-degrees, centi-percent RH,
+# relay level, seconds since boot. Matches beacon_packet_t in main.c.
+BEACON_PACKET = struct.Struct('<IHhhBI')
+BEACON_GROUP = '239.255.88.11'
+BEACON_PORT = 18999
+
+# Fan-out limits: at most this many devices are polled at once, and no
+# single request may hang a poll wave longer than the timeout. A full
+# wave therefore completes in roughly the latency of the slowest node,
+# not the sum over the fleet.
+MAX_CONCURRENT_POLLS = 16
+REQUEST_TIMEOUT = aiohttp.ClientTimeout(total=5)
+
+# Write batching: readings are buffered and flushed in one transaction
+# per batch or per interval, whichever comes first, instead of one
+# connect/insert/commit/close round trip per reading.
+BATCH_SIZE = 50
+FLUSH_INTERVAL_S = 5
+
+# Retention: raw readings older than this are rolled up into per-minute
+# averages and deleted, so the readings table stays bounded no matter
+# how long the collector runs.
+RETENTION_DAYS = 30
+
+def decode_binary_records(data):
+    """Decode packed sensor records into (timestamp, temperature, humidity) tuples."""
+    if len(data) % BINARY_RECORD.size != 0:
+        raise ValueError(f"Binary payload length {len(data)} is not a multiple of {BINARY_RECORD.size}")
+    return [(ts, temp / 100.0, hum / 100.0)
+            for temp, hum, ts in BINARY_RECORD.iter_unpack(data)]
+
+class ReadingStore:
+    """Buffered writer over one long-lived WAL-mode connection.
+
+    Readings arrive from the asyncio poll tasks and the beacon listener
+    thread, so the buffer and connection are lock-guarded. WAL keeps the
+    dashboard's readers from blocking on our writes, and batched
+    multi-row transactions keep the per-reading cost flat.
+    """
+
+    def __init__(self, path='sensor_data.db'):
+        self.conn = sqlite3.connect(path, check_same_thread=False)
+        self.lock = Lock()
+        self.buffer = []
+        self.last_rollup = 0
+        c = self.conn.cursor()
+        c.execute("PRAGMA journal_mode=WAL")
+        c.execute("PRAGMA synchronous=NORMAL")
+        c.execute("""CREATE INDEX IF NOT EXISTS idx_readings_device_ts
+                     ON readings(device_id, timestamp)""")
+        c.execute("""CREATE TABLE IF NOT EXISTS readings_rollup
+                     (minute DATETIME,
+                      device_id INTEGER,
+                      temperature REAL,
+                      humidity REAL,
+                      samples INTEGER)""")
+        c.execute("""CREATE UNIQUE INDEX IF NOT EXISTS idx_rollup_device_minute
+                     ON readings_rollup(device_id, minute)""")
+        self.conn.commit()
+
+    def add(self, device_id, temperature, humidity):
+        with self.lock:
+            self.buffer.append((datetime.now(), device_id, temperature, humidity))
+            if len(self.buffer) >= BATCH_SIZE:
+                self._flush_locked()
+
+    def flush(self):
+        with self.lock:
+            self._flush_locked()
+
+    def _flush_locked(self):
+        if not self.buffer:
+            return
+        self.conn.executemany("INSERT INTO readings VALUES (?, ?, ?, ?)",
+                              self.buffer)
+        self.conn.commit()
+        self.buffer.clear()
+
+    def apply_retention(self):
+        """Downsample raw readings older than RETENTION_DAYS into
+        per-minute averages, then delete them. Idempotent; re-running
+        after a crash mid-way just redoes the remaining rows."""
+        cutoff = f'-{RETENTION_DAYS} days'
+        with self.lock:
+            c = self.conn.cursor()
+            c.execute("""INSERT OR REPLACE INTO readings_rollup
+                         SELECT strftime('%Y-%m-%d %H:%M:00', timestamp),
+                                device_id, AVG(temperature), AVG(humidity), COUNT(*)
+                         FROM readings
+                         WHERE timestamp < datetime('now', 'localtime', ?)
+                         GROUP BY device_id, strftime('%Y-%m-%d %H:%M:00', timestamp)""",
+                      (cutoff,))
+            c.execute("DELETE FROM readings WHERE timestamp < datetime('now', 'localtime', ?)",
+                      (cutoff,))
+            self.conn.commit()
+            if c.rowcount > 0:
+                logging.info(f"Retention: rolled up {c.rowcount} raw readings")
+
+    def writer_loop(self, stop_flag):
+        """Periodic flush plus an hourly retention pass; runs on its own
+        daemon thread so a slow rollup never delays a poll wave."""
+        while not stop_flag.wait(FLUSH_INTERVAL_S):
+            self.flush()
+            now = time.time()
+            if now - self.last_rollup >= 3600:
+                self.last_rollup = now
+                try:
+                    self.apply_retention()
+                except sqlite3.Error as e:
+                    logging.error(f"Retention pass failed: {e}")
+        self.flush()
+
+
 class DeviceCollector:
     def __init__(self):
-        self.collectors = {}
-        self.stop_flags = defaultdict(Event)
+        self.device_tasks = {}
         self.main_stop_flag = Event()
         self.last_activation = defaultdict(int)
         self.timer_states = defaultdict(lambda: {"last_switch": 0, "current_state": "off"})
-        
-    def get_sensor_data(self, base_url):
+        self.beacon_last_seq = {}
+        self.poll_semaphore = None   # created inside the event loop
+        self.session = None
+        self.store = ReadingStore()
+
+    async def get_sensor_data(self, base_url):
         try:
-            response = requests.get(f"{base_url}/api/sensor")
-            return response.json()
-        except:
+            async with self.session.get(f"{base_url}/api/sensor") as response:
+                return await response.json()
+        except Exception:
             return None
 
-    def set_relay_state(self, base_url, state):
+    async def get_sensor_data_binary(self, base_url):
         try:
-            response = requests.post(f"{base_url}/api/relay", params={"state": state})
-            return response.json()
-        except:
+            async with self.session.get(f"{base_url}/api/sensor",
+                                        headers={'Accept': 'application/octet-stream'}) as response:
+                records = decode_binary_records(await response.read())
+                return records[0] if records else None
+        except Exception:
             return None
 
-    def store_reading(self, device_id, temperature, humidity):
-        conn = sqlite3.connect('sensor_data.db')
-        c = conn.cursor()
-        c.execute("INSERT INTO readings VALUES (?, ?, ?, ?)",
-                  (datetime.now(), device_id, temperature, humidity))
-        conn.commit()
-        conn.close()
+    async def get_history_binary(self, base_url, since=0):
+        try:
+            async with self.session.get(f"{base_url}/api/history",
+                                        params={'since': since},
+                                        headers={'Accept': 'application/octet-stream'}) as response:
+                return decode_binary_records(await response.read())
+        except Exception:
+            return None
+
+    async def set_relay_state(self, base_url, state):
+        try:
+            async with self.session.post(f"{base_url}/api/relay",
+                                         params={"state": state}) as response:
+                return await response.json()
+        except Exception:
+            return None
 
-    def get_timer_config(self, base_url):
+    async def get_timer_config(self, base_url):
         try:
-            response = requests.get(f"{base_url}/api/timer")
-            return response.json()
-        except:
+            async with self.session.get(f"{base_url}/api/timer") as response:
+                return await response.json()
+        except Exception:
             return None
 
-    def collect_device_data(self, device_id, device_url, frequency):
+    def store_reading(self, device_id, temperature, humidity):
+        self.store.add(device_id, temperature, humidity)
+
+    def get_device_settings(self, device_id):
         conn = sqlite3.connect('sensor_data.db')
         c = conn.cursor()
-        
-        while not self.stop_flags[device_id].is_set() and not self.main_stop_flag.is_set():
+        c.execute("""SELECT humidity_control, humidity_threshold,
+                   humidity_on_time, humidity_cooldown
+                   FROM devices WHERE id = ?""", (device_id,))
+        settings = c.fetchone()
+        conn.close()
+        return settings
+
+    async def poll_device(self, device_id, device_url):
+        """One poll wave for one device: timer/humidity control plus a
+        sensor read. Held under the fan-out semaphore by the caller, so
+        anything long (the humidity hold) is returned as a follow-up
+        coroutine to run after the semaphore is released."""
+        followup = None
+
+        settings = self.get_device_settings(device_id)
+        timer_config = await self.get_timer_config(device_url)
+        current_time = time.time()
+
+        # Handle timer control
+        if timer_config and timer_config.get('enabled'):
+            timer_state = self.timer_states[device_id]
+            on_duration = timer_config.get('onDuration', 0)
+            off_duration = timer_config.get('offDuration', 0)
+
+            if timer_state["current_state"] == "off" and current_time - timer_state["last_switch"] >= off_duration:
+                await self.set_relay_state(device_url, "on")
+                timer_state["current_state"] = "on"
+                timer_state["last_switch"] = current_time
+                logging.info(f"Timer turned ON device {device_id}")
+            elif timer_state["current_state"] == "on" and current_time - timer_state["last_switch"] >= on_duration:
+                await self.set_relay_state(device_url, "off")
+                timer_state["current_state"] = "off"
+                timer_state["last_switch"] = current_time
+                logging.info(f"Timer turned OFF device {device_id}")
+
+        # Handle humidity control only if timer is not enabled
+        elif settings and settings[0]:
+            humidity_control, threshold, on_time, cooldown = settings
+            data = await self.get_sensor_data(device_url)
+
+            if data and 'error' not in data:
+                self.store_reading(device_id, data['temperature'], data['humidity'])
+
+                if (data['humidity'] < threshold and
+                    current_time - self.last_activation[device_id] >= cooldown):
+                    await self.set_relay_state(device_url, "on")
+                    logging.info(f"Turned ON device {device_id} due to humidity {data['humidity']} below {threshold}")
+                    self.last_activation[device_id] = current_time
+
+                    async def humidity_hold():
+                        await asyncio.sleep(on_time)
+                        await self.set_relay_state(device_url, "off")
+                        logging.info(f"Turned OFF device {device_id} after {on_time} seconds")
+                    followup = humidity_hold
+
+        # Get sensor data even if no control is active
+        if not (timer_config and timer_config.get('enabled')):
+            data = await self.get_sensor_data(device_url)
+            if data and 'error' not in data:
+                self.store_reading(device_id, data['temperature'], data['humidity'])
+
+        return followup
+
+    async def collect_device_data(self, device_id, device_url, frequency):
+        while not self.main_stop_flag.is_set():
             try:
-                # Get device settings
-                c.execute("""SELECT humidity_control, humidity_threshold, 
-                           humidity_on_time, humidity_cooldown 
-                           FROM devices WHERE id = ?""", (device_id,))
-                settings = c.fetchone()
-                
-                # Get timer configuration
-                timer_config = self.get_timer_config(device_url)
-                current_time = time.time()
-                
-                # Handle timer control
-                if timer_config and timer_config.get('enabled'):
-                    timer_state = self.timer_states[device_id]
-                    on_duration = timer_config.get('onDuration', 0)
-                    off_duration = timer_config.get('offDuration', 0)
-                    
-                    if timer_state["current_state"] == "off" and current_time - timer_state["last_switch"] >= off_duration:
-                        self.set_relay_state(device_url, "on")
-                        timer_state["current_state"] = "on"
-                        timer_state["last_switch"] = current_time
-                        logging.info(f"Timer turned ON device {device_id}")
-                    elif timer_state["current_state"] == "on" and current_time - timer_state["last_switch"] >= on_duration:
-                        self.set_relay_state(device_url, "off")
-                        timer_state["current_state"] = "off"
-                        timer_state["last_switch"] = current_time
-                        logging.info(f"Timer turned OFF device {device_id}")
-                
-                # Handle humidity control only if timer is not enabled
-                elif settings and settings[0] and not (timer_config and timer_config.get('enabled')):
-                    humidity_control, threshold, on_time, cooldown = settings
-                    data = self.get_sensor_data(device_url)
-                    
-                    if data and 'error' not in data:
-                        self.store_reading(device_id, data['temperature'], data['humidity'])
-                        
-                        if (data['humidity'] < threshold and 
-                            current_time - self.last_activation[device_id] >= cooldown):
-                            self.set_relay_state(device_url, "on")
-                            logging.info(f"Turned ON device {device_id} due to humidity {data['humidity']} below {threshold}")
-                            time.sleep(on_time)
-                            self.set_relay_state(device_url, "off")
-                            self.last_activation[device_id] = current_time
-                            logging.info(f"Turned OFF device {device_id} after {on_time} seconds")
-                
-                # Get sensor data even if no control is active
-                if not (timer_config and timer_config.get('enabled')):
-                    data = self.get_sensor_data(device_url)
-                    if data and 'error' not in data:
-                        self.store_reading(device_id, data['temperature'], data['humidity'])
-                
+                async with self.poll_semaphore:
+                    followup = await self.poll_device(device_id, device_url)
+                # The humidity hold sleeps for minutes; run it outside the
+                # semaphore so it never starves other devices' polls
+                if followup is not None:
+                    await followup()
             except Exception as e:
                 logging.error(f"Error in device control loop for device {device_id}: {e}")
-            
-            time.sleep(frequency)
-        
-        conn.close()
 
-    def start_collector(self, device_id, device_url, frequency):
-        if device_id in self.collectors:
-            self.stop_flags[device_id].set()
-            self.collectors[device_id].join()
-        
-        self.stop_flags[device_id].clear()
-        collector = Thread(
-            target=self.collect_device_data,
-            args=(device_id, device_url, frequency)
-        )
-        collector.daemon = True
-        collector.start()
-        self.collectors[device_id] = collector
+            await asyncio.sleep(frequency)
+
+    def beacon_listener(self):
+        """Receive the whole fleet's multicast telemetry on one socket.
+
+        Nodes in beacon mode push each sample as a packed datagram, so no
+        polling connection is needed for them; gaps in the per-node
+        sequence number are logged and can be backfilled over
+        /api/history.
+        """
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        sock.bind(('', BEACON_PORT))
+        membership = socket.inet_aton(BEACON_GROUP) + socket.inet_aton('0.0.0.0')
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+        sock.settimeout(1.0)
+        logging.info(f"Beacon listener on {BEACON_GROUP}:{BEACON_PORT}")
+
+        while not self.main_stop_flag.is_set():
+            try:
+                data, addr = sock.recvfrom(64)
+            except socket.timeout:
+                continue
+            if len(data) != BEACON_PACKET.size:
+                continue
+            seq, node_id, temp, hum, relay, uptime = BEACON_PACKET.unpack(data)
+
+            last_seq = self.beacon_last_seq.get(node_id)
+            if last_seq is not None and seq == last_seq:
+                continue  # duplicate datagram
+            if last_seq is not None and seq > last_seq + 1:
+                logging.warning(
+                    f"Beacon node {node_id:04x}: lost {seq - last_seq - 1} datagrams")
+            self.beacon_last_seq[node_id] = seq
+
+            self.store_reading(f"beacon-{node_id:04x}", temp / 100.0, hum / 100.0)
 
     def get_active_devices(self):
         conn = sqlite3.connect('sensor_data.db')
@@ -133,24 +310,45 @@ class DeviceCollector:
         conn.close()
         return devices
 
+    async def run_async(self):
+        self.poll_semaphore = asyncio.Semaphore(MAX_CONCURRENT_POLLS)
+        async with aiohttp.ClientSession(timeout=REQUEST_TIMEOUT) as session:
+            self.session = session
+
+            while not self.main_stop_flag.is_set():
+                devices = self.get_active_devices()
+                for device_id, url, frequency in devices:
+                    task = self.device_tasks.get(device_id)
+                    if task is None or task.done():
+                        logging.info(f"Starting collector for device {device_id}")
+                        self.device_tasks[device_id] = asyncio.create_task(
+                            self.collect_device_data(device_id, url, frequency))
+                await asyncio.sleep(10)  # Check for new devices every 10 seconds
+
+            for task in self.device_tasks.values():
+                task.cancel()
+
     def run(self):
         def signal_handler(signum, frame):
             logging.info("Stopping collector service...")
             self.main_stop_flag.set()
-            for device_id in list(self.collectors.keys()):
-                self.stop_flags[device_id].set()
             sys.exit(0)
 
         signal.signal(signal.SIGINT, signal_handler)
         signal.signal(signal.SIGTERM, signal_handler)
 
-        while not self.main_stop_flag.is_set():
-            devices = self.get_active_devices()
-            for device_id, url, frequency in devices:
-                if device_id not in self.collectors:
-                    logging.info(f"Starting collector for device {device_id}")
-                    self.start_collector(device_id, url, frequency)
-            time.sleep(10)  # Check for new devices every 10 seconds
+        listener = Thread(target=self.beacon_listener)
+        listener.daemon = True
+        listener.start()
+
+        writer = Thread(target=self.store.writer_loop, args=(self.main_stop_flag,))
+        writer.daemon = True
+        writer.start()
+
+        try:
+            asyncio.run(self.run_async())
+        finally:
+            self.store.flush()
 
 if __name__ == "__main__":
     collector = DeviceCollector()
@@ -43,6 +43,22 @@ def init_db():
                       temperature REAL,
                       humidity REAL,
                       FOREIGN KEY(device_id) REFERENCES devices(id))''')
+        # WAL so chart reads never block on the collector's writes
+        c.execute('''PRAGMA journal_mode=WAL''')
+        # Time-range chart queries filter on device and timestamp; without
+        # this index they full-scan the readings table
+        c.execute('''CREATE INDEX IF NOT EXISTS idx_readings_device_ts
+                     ON readings(device_id, timestamp)''')
+        # Per-minute averages of readings past the retention window,
+        # written by the collector's rollup pass
+        c.execute('''CREATE TABLE IF NOT EXISTS readings_rollup
+                     (minute DATETIME,
+                      device_id INTEGER,
+                      temperature REAL,
+                      humidity REAL,
+                      samples INTEGER)''')
+        c.execute('''CREATE UNIQUE INDEX IF NOT EXISTS idx_rollup_device_minute
+                     ON readings_rollup(device_id, minute)''')
         # Add new columns for humidity control
         c.execute('''ALTER TABLE devices ADD COLUMN humidity_control INTEGER DEFAULT 0''')
         c.execute('''ALTER TABLE devices ADD COLUMN humidity_threshold REAL DEFAULT 0.0''')
@@ -0,0 +1,228 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include "config_store.h"
+
+#define TAG "config_store"
+
+#define CONFIG_NVS_NAMESPACE "storage"
+#define DEFAULT_HOSTNAME "ESP-LabNode"
+
+// Keys match what earlier firmware wrote, so existing nodes keep their
+// settings across an OTA to this version
+#define KEY_HOSTNAME   "hostname"
+#define KEY_WIFI_SSID  "wifi_ssid"
+#define KEY_WIFI_PASS  "wifi_pass"
+#define KEY_TIMER      "timer_cfg"
+#define KEY_HUMIDITY   "humid_cfg"
+#define KEY_SCHEDULE   "sched_cfg"
+#define KEY_AP_HINT    "ap_hint"
+
+// BSSID + channel of the last successful association
+typedef struct __attribute__((packed)) {
+    uint8_t bssid[6];
+    uint8_t channel;
+} ap_hint_t;
+
+typedef struct {
+    char hostname[CONFIG_STORE_SSID_LEN];
+    char wifi_ssid[CONFIG_STORE_SSID_LEN];
+    char wifi_pass[CONFIG_STORE_PASS_LEN];
+    bool has_wifi;
+    config_timer_defaults_t timer;
+    config_humidity_ctl_t humidity;
+    schedule_t schedule;
+    ap_hint_t ap_hint;
+    bool has_ap_hint;
+} config_cache_t;
+
+static config_cache_t cache;
+static SemaphoreHandle_t cache_mutex = NULL;
+static nvs_handle_t nvs = 0;    // kept open for the lifetime of the firmware
+
+esp_err_t config_store_init(void) {
+    cache_mutex = xSemaphoreCreateMutex();
+    if (cache_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    strcpy(cache.hostname, DEFAULT_HOSTNAME);
+    cache.has_wifi = false;
+    memset(&cache.timer, 0, sizeof(cache.timer));
+    memset(&cache.humidity, 0, sizeof(cache.humidity));
+    memset(&cache.schedule, 0, sizeof(cache.schedule));
+
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    size_t len = sizeof(cache.hostname);
+    nvs_get_str(nvs, KEY_HOSTNAME, cache.hostname, &len);
+
+    len = sizeof(cache.wifi_ssid);
+    if (nvs_get_str(nvs, KEY_WIFI_SSID, cache.wifi_ssid, &len) == ESP_OK) {
+        len = sizeof(cache.wifi_pass);
+        if (nvs_get_str(nvs, KEY_WIFI_PASS, cache.wifi_pass, &len) == ESP_OK) {
+            cache.has_wifi = true;
+        }
+    }
+
+    len = sizeof(cache.timer);
+    nvs_get_blob(nvs, KEY_TIMER, &cache.timer, &len);
+
+    len = sizeof(cache.humidity);
+    nvs_get_blob(nvs, KEY_HUMIDITY, &cache.humidity, &len);
+
+    len = sizeof(cache.schedule);
+    nvs_get_blob(nvs, KEY_SCHEDULE, &cache.schedule, &len);
+
+    len = sizeof(cache.ap_hint);
+    if (nvs_get_blob(nvs, KEY_AP_HINT, &cache.ap_hint, &len) == ESP_OK) {
+        cache.has_ap_hint = true;
+    }
+
+    ESP_LOGI(TAG, "Loaded config: hostname=%s, wifi=%s",
+             cache.hostname, cache.has_wifi ? "saved" : "none");
+    return ESP_OK;
+}
+
+void config_store_get_hostname(char *buf, size_t len) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    strncpy(buf, cache.hostname, len - 1);
+    buf[len - 1] = '\0';
+    xSemaphoreGive(cache_mutex);
+}
+
+esp_err_t config_store_set_hostname(const char *hostname) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    strncpy(cache.hostname, hostname, sizeof(cache.hostname) - 1);
+    cache.hostname[sizeof(cache.hostname) - 1] = '\0';
+
+    esp_err_t err = nvs_set_str(nvs, KEY_HOSTNAME, cache.hostname);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+bool config_store_get_wifi(char *ssid, size_t ssid_len, char *pass, size_t pass_len) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    bool has_wifi = cache.has_wifi;
+    if (has_wifi) {
+        strncpy(ssid, cache.wifi_ssid, ssid_len - 1);
+        ssid[ssid_len - 1] = '\0';
+        strncpy(pass, cache.wifi_pass, pass_len - 1);
+        pass[pass_len - 1] = '\0';
+    }
+    xSemaphoreGive(cache_mutex);
+    return has_wifi;
+}
+
+esp_err_t config_store_set_wifi(const char *ssid, const char *pass) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    strncpy(cache.wifi_ssid, ssid, sizeof(cache.wifi_ssid) - 1);
+    cache.wifi_ssid[sizeof(cache.wifi_ssid) - 1] = '\0';
+    strncpy(cache.wifi_pass, pass, sizeof(cache.wifi_pass) - 1);
+    cache.wifi_pass[sizeof(cache.wifi_pass) - 1] = '\0';
+    cache.has_wifi = true;
+
+    // Both keys go into one commit
+    esp_err_t err = nvs_set_str(nvs, KEY_WIFI_SSID, cache.wifi_ssid);
+    if (err == ESP_OK) {
+        err = nvs_set_str(nvs, KEY_WIFI_PASS, cache.wifi_pass);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+void config_store_get_timer(config_timer_defaults_t *out) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = cache.timer;
+    xSemaphoreGive(cache_mutex);
+}
+
+esp_err_t config_store_set_timer(const config_timer_defaults_t *defaults) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    cache.timer = *defaults;
+    esp_err_t err = nvs_set_blob(nvs, KEY_TIMER, &cache.timer, sizeof(cache.timer));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+void config_store_get_humidity_ctl(config_humidity_ctl_t *out) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = cache.humidity;
+    xSemaphoreGive(cache_mutex);
+}
+
+esp_err_t config_store_set_humidity_ctl(const config_humidity_ctl_t *ctl) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    cache.humidity = *ctl;
+    esp_err_t err = nvs_set_blob(nvs, KEY_HUMIDITY, &cache.humidity, sizeof(cache.humidity));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+void config_store_get_schedule(schedule_t *out) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = cache.schedule;
+    xSemaphoreGive(cache_mutex);
+}
+
+esp_err_t config_store_set_schedule(const schedule_t *schedule) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    cache.schedule = *schedule;
+    esp_err_t err = nvs_set_blob(nvs, KEY_SCHEDULE, &cache.schedule, sizeof(cache.schedule));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+bool config_store_get_ap_hint(uint8_t bssid[6], uint8_t *channel) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    bool has_hint = cache.has_ap_hint;
+    if (has_hint) {
+        memcpy(bssid, cache.ap_hint.bssid, 6);
+        *channel = cache.ap_hint.channel;
+    }
+    xSemaphoreGive(cache_mutex);
+    return has_hint;
+}
+
+esp_err_t config_store_set_ap_hint(const uint8_t bssid[6], uint8_t channel) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+
+    // Skip the flash write when nothing changed (every reconnect calls this)
+    if (cache.has_ap_hint && cache.ap_hint.channel == channel &&
+        memcmp(cache.ap_hint.bssid, bssid, 6) == 0) {
+        xSemaphoreGive(cache_mutex);
+        return ESP_OK;
+    }
+
+    memcpy(cache.ap_hint.bssid, bssid, 6);
+    cache.ap_hint.channel = channel;
+    cache.has_ap_hint = true;
+
+    esp_err_t err = nvs_set_blob(nvs, KEY_AP_HINT, &cache.ap_hint, sizeof(cache.ap_hint));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
@@ -0,0 +1,60 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "schedule.h"
+
+// RAM-cached configuration in front of NVS. Everything is loaded once at
+// boot; reads are plain memory copies and never touch flash. Setters update
+// the cache, write through to NVS and commit once per call, so the
+// millisecond-scale flash I/O happens only when something actually changes.
+
+#define CONFIG_STORE_SSID_LEN 33
+#define CONFIG_STORE_PASS_LEN 65
+
+// Persisted timer defaults, applied to the relay timer at boot
+typedef struct {
+    bool enabled;
+    uint32_t on_duration_ms;
+    uint32_t off_duration_ms;
+} config_timer_defaults_t;
+
+// Persisted humidity hysteresis controller settings
+typedef struct {
+    bool enabled;
+    float threshold;        // percent RH that triggers the relay
+    uint32_t on_time_s;     // how long the relay stays on per trigger
+    uint32_t cooldown_s;    // minimum off time between triggers
+} config_humidity_ctl_t;
+
+// Load all keys from NVS into the cache. Call once, after nvs_flash_init().
+esp_err_t config_store_init(void);
+
+// Hostname (falls back to the compile-time default when unset)
+void config_store_get_hostname(char *buf, size_t len);
+esp_err_t config_store_set_hostname(const char *hostname);
+
+// WiFi credentials; the getter returns false when none are stored
+bool config_store_get_wifi(char *ssid, size_t ssid_len, char *pass, size_t pass_len);
+esp_err_t config_store_set_wifi(const char *ssid, const char *pass);
+
+// Relay timer defaults
+void config_store_get_timer(config_timer_defaults_t *out);
+esp_err_t config_store_set_timer(const config_timer_defaults_t *defaults);
+
+// Humidity controller settings
+void config_store_get_humidity_ctl(config_humidity_ctl_t *out);
+esp_err_t config_store_set_humidity_ctl(const config_humidity_ctl_t *ctl);
+
+// Relay schedule entries
+void config_store_get_schedule(schedule_t *out);
+esp_err_t config_store_set_schedule(const schedule_t *schedule);
+
+// Last successful AP (BSSID + channel) for directed fast reconnect; the
+// getter returns false when no association has been recorded yet
+bool config_store_get_ap_hint(uint8_t bssid[6], uint8_t *channel);
+esp_err_t config_store_set_ap_hint(const uint8_t bssid[6], uint8_t channel);
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,15 @@
+#include "dht_decode.h"
+
+esp_err_t dht_decode_payload(const uint8_t data[5], float *temperature, float *humidity) {
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *humidity = ((data[0] << 8) | data[1]) * 0.1;
+    int16_t raw_temp = ((data[2] & 0x7F) << 8) | data[3];
+    *temperature = raw_temp * 0.1;
+    if (data[2] & 0x80) {
+        *temperature = -*temperature;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,16 @@
+#ifndef DHT_DECODE_H
+#define DHT_DECODE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Pure DHT payload decoding, shared by the RMT and bit-banged capture paths
+// and by the host-side test harness (no hardware or IDF dependencies).
+
+// Verify the checksum of a captured 5-byte DHT frame and convert it using
+// the DHT22 encoding: 16-bit humidity and temperature in tenths, with the
+// temperature sign in the top bit. Returns ESP_ERR_INVALID_CRC on a bad
+// checksum.
+esp_err_t dht_decode_payload(const uint8_t data[5], float *temperature, float *humidity);
+
+#endif // DHT_DECODE_H
@@ -0,0 +1,166 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/rmt_rx.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "dht_rmt.h"
+#include "dht_decode.h"
+
+#define TAG "dht_rmt"
+
+// DHT22 frame: 80us/80us response pulse followed by 40 bits, each a ~50us
+// low period plus a high period of ~27us (0) or ~70us (1).
+#define DHT_RMT_RESOLUTION_HZ   1000000     // 1 us per RMT tick
+#define DHT_RMT_MAX_SYMBOLS     48          // response + 40 data bits + slack
+#define DHT_RMT_GLITCH_NS       1000        // ignore pulses under 1 us
+#define DHT_RMT_IDLE_NS         300000      // frame ends after 300 us of idle
+#define DHT_BIT_THRESHOLD_US    40          // high pulse longer than this is a 1
+#define DHT_START_SIGNAL_MS     20          // host start signal (>= 1 ms low)
+#define DHT_READ_TIMEOUT_MS     100
+
+// One capture instance per sensor GPIO
+typedef struct {
+    gpio_num_t gpio;
+    rmt_channel_handle_t channel;
+    QueueHandle_t rx_done_queue;
+    rmt_symbol_word_t symbols[DHT_RMT_MAX_SYMBOLS];
+} dht_rmt_instance_t;
+
+static dht_rmt_instance_t instances[DHT_RMT_MAX_SENSORS];
+static int instance_count = 0;
+
+static dht_rmt_instance_t *find_instance(gpio_num_t gpio) {
+    for (int i = 0; i < instance_count; i++) {
+        if (instances[i].gpio == gpio) {
+            return &instances[i];
+        }
+    }
+    return NULL;
+}
+
+static bool rx_done_callback(rmt_channel_handle_t channel,
+                             const rmt_rx_done_event_data_t *edata, void *user_ctx) {
+    dht_rmt_instance_t *inst = (dht_rmt_instance_t *)user_ctx;
+    BaseType_t task_woken = pdFALSE;
+    xQueueSendFromISR(inst->rx_done_queue, edata, &task_woken);
+    return task_woken == pdTRUE;
+}
+
+esp_err_t dht_rmt_init(gpio_num_t gpio) {
+    if (instance_count >= DHT_RMT_MAX_SENSORS || find_instance(gpio) != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    dht_rmt_instance_t *inst = &instances[instance_count];
+
+    rmt_rx_channel_config_t rx_config = {
+        .gpio_num = gpio,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = 64,
+    };
+
+    esp_err_t err = rmt_new_rx_channel(&rx_config, &inst->channel);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No free RMT channel for GPIO %d (%s), using bit-banged fallback",
+                 gpio, esp_err_to_name(err));
+        return err;
+    }
+
+    inst->rx_done_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if (inst->rx_done_queue == NULL) {
+        rmt_del_channel(inst->channel);
+        return ESP_ERR_NO_MEM;
+    }
+
+    rmt_rx_event_callbacks_t callbacks = {
+        .on_recv_done = rx_done_callback,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(inst->channel, &callbacks, inst));
+    ESP_ERROR_CHECK(rmt_enable(inst->channel));
+
+    inst->gpio = gpio;
+    instance_count++;
+    ESP_LOGI(TAG, "RMT capture enabled on GPIO %d", gpio);
+    return ESP_OK;
+}
+
+bool dht_rmt_available(gpio_num_t gpio) {
+    return find_instance(gpio) != NULL;
+}
+
+// Decode the captured pulse train into the 5-byte DHT payload.
+static esp_err_t decode_symbols(const rmt_symbol_word_t *symbols, size_t count,
+                                uint8_t data[5]) {
+    memset(data, 0, 5);
+
+    // Skip the 80us/80us response pulse: data bits start once the high
+    // period is short enough to be a bit, not the response handshake.
+    size_t start = 0;
+    while (start < count && symbols[start].duration1 > 75) {
+        start++;
+    }
+
+    if (count - start < 40) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    for (int i = 0; i < 40; i++) {
+        const rmt_symbol_word_t *sym = &symbols[start + i];
+        data[i / 8] <<= 1;
+        if (sym->duration1 > DHT_BIT_THRESHOLD_US) {
+            data[i / 8] |= 1;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t dht_rmt_read(gpio_num_t gpio, float *temperature, float *humidity) {
+    dht_rmt_instance_t *inst = find_instance(gpio);
+    if (inst == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    rmt_receive_config_t receive_config = {
+        .signal_range_min_ns = DHT_RMT_GLITCH_NS,
+        .signal_range_max_ns = DHT_RMT_IDLE_NS,
+    };
+
+    // Send start signal: pull the line low, then release it back to the
+    // RMT receiver before the sensor answers. Plain task delays are fine
+    // here; only the sensor's reply has microsecond timing, and the RMT
+    // peripheral captures that in hardware.
+    gpio_set_direction(inst->gpio, GPIO_MODE_OUTPUT_OD);
+    gpio_set_level(inst->gpio, 0);
+    vTaskDelay(pdMS_TO_TICKS(DHT_START_SIGNAL_MS));
+
+    xQueueReset(inst->rx_done_queue);
+    ESP_ERROR_CHECK(rmt_receive(inst->channel, inst->symbols, sizeof(inst->symbols),
+                                &receive_config));
+
+    gpio_set_level(inst->gpio, 1);
+    gpio_set_direction(inst->gpio, GPIO_MODE_INPUT);
+    gpio_pullup_en(inst->gpio);
+
+    rmt_rx_done_event_data_t rx_data;
+    if (xQueueReceive(inst->rx_done_queue, &rx_data,
+                      pdMS_TO_TICKS(DHT_READ_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "No response from sensor on GPIO %d", inst->gpio);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t data[5];
+    esp_err_t err = decode_symbols(rx_data.received_symbols,
+                                   rx_data.num_symbols, data);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Short frame: %d symbols", (int)rx_data.num_symbols);
+        return err;
+    }
+
+    err = dht_decode_payload(data, temperature, humidity);
+    if (err == ESP_ERR_INVALID_CRC) {
+        ESP_LOGE(TAG, "Checksum failed");
+    }
+    return err;
+}
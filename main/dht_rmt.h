@@ -0,0 +1,28 @@
+#ifndef DHT_RMT_H
+#define DHT_RMT_H
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// DHT capture engine built on the RMT peripheral. Each sensor GPIO gets its
+// own RMT RX channel that records the full pulse train in hardware, so no
+// interrupt masking or busy-waiting is needed; decoding happens afterwards
+// in task context.
+
+// Maximum sensors with a dedicated RMT channel (bounded by free channels)
+#define DHT_RMT_MAX_SENSORS 4
+
+// Claim an RMT RX channel for a sensor GPIO. May be called once per sensor.
+// Returns ESP_ERR_NOT_FOUND (or the underlying driver error) when no
+// channel is free, in which case the caller should keep using the
+// bit-banged fallback for that GPIO.
+esp_err_t dht_rmt_init(gpio_num_t gpio);
+
+// True once dht_rmt_init() has succeeded for this GPIO.
+bool dht_rmt_available(gpio_num_t gpio);
+
+// Perform one DHT22 transaction through the RMT capture path.
+// Blocks the calling task (no interrupt masking) for the ~5 ms transaction.
+esp_err_t dht_rmt_read(gpio_num_t gpio, float *temperature, float *humidity);
+
+#endif // DHT_RMT_H
@@ -0,0 +1,76 @@
+#include <string.h>
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "esp_log.h"
+#include "espnow_link.h"
+
+#define TAG "espnow_link"
+
+static const uint8_t broadcast_mac[ESP_NOW_ETH_ALEN] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static espnow_reading_cb_t reading_cb = NULL;
+
+esp_err_t espnow_link_init_leaf(void) {
+    // Station interface without association: start the radio, pin the
+    // channel, and disable power save so broadcast frames go out promptly
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_set_channel(CONFIG_ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE));
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+
+    esp_err_t err = esp_now_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_now_init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    esp_now_peer_info_t peer = {
+        .channel = CONFIG_ESPNOW_CHANNEL,
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, broadcast_mac, ESP_NOW_ETH_ALEN);
+    err = esp_now_add_peer(&peer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Adding broadcast peer failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Leaf link up on channel %d", CONFIG_ESPNOW_CHANNEL);
+    return ESP_OK;
+}
+
+esp_err_t espnow_link_send(const espnow_reading_t *reading) {
+    return esp_now_send(broadcast_mac, (const uint8_t *)reading, sizeof(*reading));
+}
+
+static void recv_callback(const esp_now_recv_info_t *info,
+                          const uint8_t *data, int len) {
+    if (len != sizeof(espnow_reading_t) || reading_cb == NULL) {
+        return;
+    }
+    espnow_reading_t reading;
+    memcpy(&reading, data, sizeof(reading));
+    reading_cb(&reading);
+}
+
+esp_err_t espnow_link_init_relay(espnow_reading_cb_t on_reading) {
+    esp_err_t err = esp_now_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_now_init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    reading_cb = on_reading;
+    err = esp_now_register_recv_cb(recv_callback);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Leaves broadcast, so no peer entry is needed to receive; the relay
+    // listens on whatever channel its AP association pinned
+    ESP_LOGI(TAG, "Relay link listening for leaf nodes");
+    return ESP_OK;
+}
@@ -0,0 +1,39 @@
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// ESP-NOW transport for nodes beyond AP range. A leaf node never joins
+// the station network: it broadcasts its packed readings on a fixed
+// channel, and any in-range relay node that hears them forwards them
+// alongside its own telemetry. ESP-NOW frames are far cheaper than a
+// full WiFi association for a node moving 16 bytes a minute.
+
+// One reading as carried over the air. Same field layout and units as
+// the UDP beacon packet, so a relay can forward it unmodified.
+typedef struct __attribute__((packed)) {
+    uint32_t seq;           // per-boot sequence number
+    uint16_t node_id;       // last two bytes of the sender's MAC
+    int16_t temperature;    // centi-degrees C
+    int16_t humidity;       // centi-percent RH
+    uint8_t relay;          // sender's relay level
+    uint32_t uptime_s;      // sender's seconds since boot
+} espnow_reading_t;
+
+typedef void (*espnow_reading_cb_t)(const espnow_reading_t *reading);
+
+// Leaf role: bring up WiFi unassociated on CONFIG_ESPNOW_CHANNEL (must
+// match the channel the relay's AP uses) and prepare the broadcast peer.
+esp_err_t espnow_link_init_leaf(void);
+
+// Send one reading as a broadcast frame. Fire-and-forget; a dropped
+// frame is one lost sample, like a lost beacon datagram.
+esp_err_t espnow_link_send(const espnow_reading_t *reading);
+
+// Relay role: register for incoming readings on top of the existing
+// station interface. The callback runs in the WiFi task context, so it
+// must stay short and non-blocking.
+esp_err_t espnow_link_init_relay(espnow_reading_cb_t on_reading);
+
+#endif // ESPNOW_LINK_H
@@ -0,0 +1,201 @@
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "flash_store.h"
+
+#define TAG "flash_store"
+
+// Custom data-partition subtype for the history log (partitions.csv)
+#define HISTORY_PARTITION_SUBTYPE 0x40
+
+#define SECTOR_SIZE 4096
+#define RECORD_SIZE sizeof(flash_record_t)
+#define RECORDS_PER_SECTOR ((SECTOR_SIZE - sizeof(sector_header_t)) / RECORD_SIZE)
+
+// Each sector starts with a monotonically increasing sequence number, so
+// the write head after a reboot is simply the sector with the highest
+// sequence, and read order is sequence order regardless of wrap-around.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;
+} sector_header_t;
+
+#define SECTOR_MAGIC 0x54534948  // "HIST"
+#define TIMESTAMP_EMPTY 0xFFFFFFFF
+
+static const esp_partition_t *partition = NULL;
+static uint32_t sector_count = 0;
+static uint32_t cur_sector = 0;     // sector being filled
+static uint32_t cur_seq = 0;        // its sequence number
+static uint32_t cur_record = 0;     // next record slot within it
+
+static size_t record_offset(uint32_t sector, uint32_t record) {
+    return (size_t)sector * SECTOR_SIZE + sizeof(sector_header_t) +
+           (size_t)record * RECORD_SIZE;
+}
+
+// Number of records already programmed into a sector
+static uint32_t scan_sector_fill(uint32_t sector) {
+    for (uint32_t i = 0; i < RECORDS_PER_SECTOR; i++) {
+        flash_record_t rec;
+        if (esp_partition_read(partition, record_offset(sector, i),
+                               &rec, RECORD_SIZE) != ESP_OK) {
+            return i;
+        }
+        if (rec.timestamp == TIMESTAMP_EMPTY) {
+            return i;
+        }
+    }
+    return RECORDS_PER_SECTOR;
+}
+
+esp_err_t flash_store_init(void) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         HISTORY_PARTITION_SUBTYPE, "history");
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No 'history' partition; flash history disabled");
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_count = partition->size / SECTOR_SIZE;
+
+    // Find the newest sector by sequence number
+    uint32_t newest_seq = 0;
+    uint32_t newest_sector = 0;
+    bool found = false;
+    for (uint32_t s = 0; s < sector_count; s++) {
+        sector_header_t header;
+        if (esp_partition_read(partition, (size_t)s * SECTOR_SIZE,
+                               &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        if (header.magic == SECTOR_MAGIC && (!found || header.seq > newest_seq)) {
+            newest_seq = header.seq;
+            newest_sector = s;
+            found = true;
+        }
+    }
+
+    if (found) {
+        cur_sector = newest_sector;
+        cur_seq = newest_seq;
+        cur_record = scan_sector_fill(newest_sector);
+    } else {
+        // Empty store: position so the first append opens sector 0
+        cur_sector = sector_count - 1;
+        cur_seq = 0;
+        cur_record = RECORDS_PER_SECTOR;
+    }
+
+    ESP_LOGI(TAG, "History partition: %u sectors, head at sector %u seq %u record %u",
+             (unsigned)sector_count, (unsigned)cur_sector,
+             (unsigned)cur_seq, (unsigned)cur_record);
+    return ESP_OK;
+}
+
+bool flash_store_available(void) {
+    return partition != NULL;
+}
+
+// Erase the next sector in the ring and stamp its header
+static esp_err_t open_next_sector(void) {
+    uint32_t next = (cur_sector + 1) % sector_count;
+    esp_err_t err = esp_partition_erase_range(partition,
+                                              (size_t)next * SECTOR_SIZE, SECTOR_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sector erase failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    sector_header_t header = {
+        .magic = SECTOR_MAGIC,
+        .seq = cur_seq + 1,
+    };
+    err = esp_partition_write(partition, (size_t)next * SECTOR_SIZE,
+                              &header, sizeof(header));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    cur_sector = next;
+    cur_seq++;
+    cur_record = 0;
+    return ESP_OK;
+}
+
+void flash_store_append(uint32_t timestamp, float temperature, float humidity) {
+    if (partition == NULL) {
+        return;
+    }
+    if (cur_record >= RECORDS_PER_SECTOR) {
+        if (open_next_sector() != ESP_OK) {
+            return;
+        }
+    }
+
+    flash_record_t rec = {
+        .temperature = (int16_t)(temperature * 100),
+        .humidity = (int16_t)(humidity * 100),
+        .timestamp = timestamp,
+    };
+    esp_err_t err = esp_partition_write(partition,
+                                        record_offset(cur_sector, cur_record),
+                                        &rec, RECORD_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(err));
+        return;
+    }
+    cur_record++;
+}
+
+esp_err_t flash_store_read(uint32_t since, flash_store_record_cb_t cb, void *ctx) {
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Oldest valid sequence still present: newest minus (used sectors - 1)
+    uint32_t used = 0;
+    for (uint32_t s = 0; s < sector_count; s++) {
+        sector_header_t header;
+        if (esp_partition_read(partition, (size_t)s * SECTOR_SIZE,
+                               &header, sizeof(header)) == ESP_OK &&
+            header.magic == SECTOR_MAGIC) {
+            used++;
+        }
+    }
+    if (used == 0) {
+        return ESP_OK;
+    }
+    uint32_t oldest_seq = cur_seq - used + 1;
+
+    // Walk sequences in order; each lookup scans headers, which is fine
+    // for a couple hundred sectors on a backfill path
+    for (uint32_t seq = oldest_seq; seq <= cur_seq; seq++) {
+        for (uint32_t s = 0; s < sector_count; s++) {
+            sector_header_t header;
+            if (esp_partition_read(partition, (size_t)s * SECTOR_SIZE,
+                                   &header, sizeof(header)) != ESP_OK ||
+                header.magic != SECTOR_MAGIC || header.seq != seq) {
+                continue;
+            }
+            for (uint32_t i = 0; i < RECORDS_PER_SECTOR; i++) {
+                flash_record_t rec;
+                if (esp_partition_read(partition, record_offset(s, i),
+                                       &rec, RECORD_SIZE) != ESP_OK) {
+                    break;
+                }
+                if (rec.timestamp == TIMESTAMP_EMPTY) {
+                    break;  // rest of the sector is unwritten
+                }
+                if (rec.timestamp <= since) {
+                    continue;
+                }
+                esp_err_t err = cb(ctx, &rec);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            break;
+        }
+    }
+    return ESP_OK;
+}
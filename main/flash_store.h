@@ -0,0 +1,44 @@
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Circular time-series log on a raw flash partition, so buffered history
+// survives reboots (brownout, OTA, watchdog). Records are fixed-size and
+// packed — the same 8-byte layout as the binary wire format — so the
+// on-flash data is seekable without parsing and backfill is a couple of
+// flash reads, not a scan.
+//
+// Wear model: each 4 KB sector is erased once, then records are
+// programmed into it incrementally (NOR bits only go 1 -> 0), so a
+// sample costs one small program and a sector erase happens once per
+// 511 samples. Nothing is buffered in RAM, so a power cut loses at most
+// the sample being written.
+
+typedef struct __attribute__((packed)) {
+    int16_t temperature;    // centi-degrees C
+    int16_t humidity;       // centi-percent RH
+    uint32_t timestamp;     // epoch seconds once SNTP synced, else uptime
+} flash_record_t;
+
+typedef esp_err_t (*flash_store_record_cb_t)(void *ctx, const flash_record_t *rec);
+
+// Locate the "history" data partition and find the write head by sector
+// sequence number. Returns ESP_ERR_NOT_FOUND when the partition table
+// has no such partition; the store then stays disabled.
+esp_err_t flash_store_init(void);
+
+// True once init succeeded.
+bool flash_store_available(void);
+
+// Append one reading. Called from the sampling task; erase/program
+// latency (worst case a sector erase, ~tens of ms) is acceptable there.
+void flash_store_append(uint32_t timestamp, float temperature, float humidity);
+
+// Stream every stored record newer than `since` in write order through
+// the callback. Stops early if the callback returns an error.
+esp_err_t flash_store_read(uint32_t since, flash_store_record_cb_t cb, void *ctx);
+
+#endif // FLASH_STORE_H
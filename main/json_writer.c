@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include "json_writer.h"
+
+void json_writer_init(json_writer_t *jw, json_writer_flush_t flush, void *flush_ctx) {
+    jw->len = 0;
+    jw->need_comma = false;
+    jw->failed = false;
+    jw->flush = flush;
+    jw->flush_ctx = flush_ctx;
+}
+
+static void writer_flush(json_writer_t *jw) {
+    // len is cleared even when the flush is skipped or fails, so a
+    // failed writer keeps discarding output instead of overrunning buf
+    if (jw->len > 0 && !jw->failed) {
+        if (jw->flush(jw->flush_ctx, jw->buf, jw->len) != ESP_OK) {
+            jw->failed = true;
+        }
+    }
+    jw->len = 0;
+}
+
+static void writer_putc(json_writer_t *jw, char c) {
+    if (jw->len == sizeof(jw->buf)) {
+        writer_flush(jw);
+    }
+    jw->buf[jw->len++] = c;
+}
+
+static void writer_puts(json_writer_t *jw, const char *s) {
+    while (*s) {
+        writer_putc(jw, *s++);
+    }
+}
+
+// Quoted string with the escapes JSON requires; control characters are
+// emitted as \u00XX (scan results can contain arbitrary SSID bytes).
+static void writer_put_quoted(json_writer_t *jw, const char *s) {
+    writer_putc(jw, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            writer_putc(jw, '\\');
+            writer_putc(jw, c);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            writer_puts(jw, esc);
+        } else {
+            writer_putc(jw, c);
+        }
+    }
+    writer_putc(jw, '"');
+}
+
+// Comma separator plus optional "key": prefix shared by all members
+static void writer_member(json_writer_t *jw, const char *key) {
+    if (jw->need_comma) {
+        writer_putc(jw, ',');
+    }
+    if (key != NULL) {
+        writer_put_quoted(jw, key);
+        writer_putc(jw, ':');
+    }
+    jw->need_comma = true;
+}
+
+void json_writer_object_begin(json_writer_t *jw) {
+    if (jw->need_comma) {
+        writer_putc(jw, ',');
+    }
+    writer_putc(jw, '{');
+    jw->need_comma = false;
+}
+
+void json_writer_object_end(json_writer_t *jw) {
+    writer_putc(jw, '}');
+    jw->need_comma = true;
+}
+
+void json_writer_array_begin(json_writer_t *jw, const char *key) {
+    writer_member(jw, key);
+    writer_putc(jw, '[');
+    jw->need_comma = false;
+}
+
+void json_writer_array_end(json_writer_t *jw) {
+    writer_putc(jw, ']');
+    jw->need_comma = true;
+}
+
+void json_writer_string(json_writer_t *jw, const char *key, const char *value) {
+    writer_member(jw, key);
+    writer_put_quoted(jw, value);
+}
+
+void json_writer_int(json_writer_t *jw, const char *key, int32_t value) {
+    char num[16];
+    snprintf(num, sizeof(num), "%ld", (long)value);
+    writer_member(jw, key);
+    writer_puts(jw, num);
+}
+
+void json_writer_uint(json_writer_t *jw, const char *key, uint32_t value) {
+    char num[16];
+    snprintf(num, sizeof(num), "%lu", (unsigned long)value);
+    writer_member(jw, key);
+    writer_puts(jw, num);
+}
+
+void json_writer_float1(json_writer_t *jw, const char *key, float value) {
+    char num[24];
+    snprintf(num, sizeof(num), "%.1f", value);
+    writer_member(jw, key);
+    writer_puts(jw, num);
+}
+
+void json_writer_bool(json_writer_t *jw, const char *key, bool value) {
+    writer_member(jw, key);
+    writer_puts(jw, value ? "true" : "false");
+}
+
+esp_err_t json_writer_finish(json_writer_t *jw) {
+    writer_flush(jw);
+    return jw->failed ? ESP_FAIL : ESP_OK;
+}
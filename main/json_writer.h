@@ -0,0 +1,47 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Streaming JSON writer with a fixed scratch buffer: no heap allocation and
+// no quadratic strcat appends. Output is pushed through a flush callback
+// whenever the buffer fills, so response size is unbounded while stack use
+// stays constant. The httpd handlers flush into httpd_resp_send_chunk()
+// via json_writer_init_httpd().
+
+#define JSON_WRITER_BUF_SIZE 256
+
+// Flush callback: send len bytes, return ESP_OK to keep writing.
+typedef esp_err_t (*json_writer_flush_t)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    char buf[JSON_WRITER_BUF_SIZE];
+    size_t len;
+    bool need_comma;
+    bool failed;
+    json_writer_flush_t flush;
+    void *flush_ctx;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *jw, json_writer_flush_t flush, void *flush_ctx);
+
+// Structure
+void json_writer_object_begin(json_writer_t *jw);
+void json_writer_object_end(json_writer_t *jw);
+void json_writer_array_begin(json_writer_t *jw, const char *key);
+void json_writer_array_end(json_writer_t *jw);
+
+// Key/value members (key NULL inside arrays)
+void json_writer_string(json_writer_t *jw, const char *key, const char *value);
+void json_writer_int(json_writer_t *jw, const char *key, int32_t value);
+void json_writer_uint(json_writer_t *jw, const char *key, uint32_t value);
+void json_writer_float1(json_writer_t *jw, const char *key, float value);
+void json_writer_bool(json_writer_t *jw, const char *key, bool value);
+
+// Flush any buffered output; returns ESP_FAIL if any flush failed.
+esp_err_t json_writer_finish(json_writer_t *jw);
+
+#endif // JSON_WRITER_H
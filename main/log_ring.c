@@ -0,0 +1,81 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "log_ring.h"
+
+// Ring geometry: 256 lines of up to 127 characters is ~32 KB of RAM and
+// covers hours of quiet operation or the last minute of a failure storm.
+// Longer lines are truncated, not split.
+#define LOG_RING_ENTRIES 256
+#define LOG_RING_ENTRY_LEN 128
+
+static char entries[LOG_RING_ENTRIES][LOG_RING_ENTRY_LEN];
+static uint32_t next_line = 0;  // total lines ever written; ring index is mod
+
+static portMUX_TYPE log_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static vprintf_like_t prev_vprintf = NULL;
+
+// esp_log sink: format into a stack buffer, memcpy into the ring under
+// the spinlock, then hand the line to the previous sink (UART). Runs in
+// whatever task logged, so it must not block or log itself.
+static int log_ring_vprintf(const char *format, va_list args) {
+    char line[LOG_RING_ENTRY_LEN];
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(line, sizeof(line), format, args_copy);
+    va_end(args_copy);
+
+    if (len > 0) {
+        // Drop the trailing newline; /api/logs re-adds one per entry
+        size_t stored = (len < (int)sizeof(line)) ? (size_t)len : sizeof(line) - 1;
+        while (stored > 0 && line[stored - 1] == '\n') {
+            stored--;
+        }
+        line[stored] = '\0';
+
+        portENTER_CRITICAL(&log_ring_lock);
+        memcpy(entries[next_line % LOG_RING_ENTRIES], line, stored + 1);
+        next_line++;
+        portEXIT_CRITICAL(&log_ring_lock);
+    }
+
+    if (prev_vprintf != NULL) {
+        return prev_vprintf(format, args);
+    }
+    return len;
+}
+
+void log_ring_init(void) {
+    prev_vprintf = esp_log_set_vprintf(log_ring_vprintf);
+}
+
+esp_err_t log_ring_get_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain");
+
+    portENTER_CRITICAL(&log_ring_lock);
+    uint32_t end = next_line;
+    portEXIT_CRITICAL(&log_ring_lock);
+    uint32_t start = (end > LOG_RING_ENTRIES) ? end - LOG_RING_ENTRIES : 0;
+
+    for (uint32_t i = start; i < end; i++) {
+        // Copy each line out under the lock; the writer may lap us while
+        // we block in send, in which case the lapped lines come out as
+        // whatever replaced them — harmless for a diagnostic dump
+        char line[LOG_RING_ENTRY_LEN + 1];
+        portENTER_CRITICAL(&log_ring_lock);
+        size_t len = strlen(entries[i % LOG_RING_ENTRIES]);
+        memcpy(line, entries[i % LOG_RING_ENTRIES], len);
+        portEXIT_CRITICAL(&log_ring_lock);
+        line[len] = '\n';
+
+        if (httpd_resp_send_chunk(req, line, len + 1) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
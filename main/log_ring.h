@@ -0,0 +1,21 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// In-RAM ring buffer sink for the esp_log output, so the last few hundred
+// log lines survive on a deployed node with nothing attached to the UART
+// and can be pulled over HTTP after the fact. The hook copies each
+// formatted line into the ring under a spinlock (a memcpy, not a UART
+// write) and then forwards to the previous vprintf, so bench builds keep
+// their serial console.
+
+// Capture esp_log output from this point on. Call early in app_main so
+// boot-time lines land in the ring too.
+void log_ring_init(void);
+
+// GET /api/logs handler: the buffered lines, oldest first, as text/plain.
+esp_err_t log_ring_get_handler(httpd_req_t *req);
+
+#endif // LOG_RING_H
@@ -2,22 +2,56 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_http_server.h"
+#include "esp_ota_ops.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
 #include <stdio.h>
 #include <string.h>
 #include "esp_timer.h"
 #include "mdns.h"
+#include "dht_rmt.h"
+#include "dht_decode.h"
+#include "sht3x.h"
+#include "request_parse.h"
+#include "json_writer.h"
+#include "config_store.h"
+#include "power_scheduler.h"
+#include "metrics.h"
+#include "log_ring.h"
+#include "schedule.h"
+#if CONFIG_HISTORY_FLASH
+#include "flash_store.h"
+#endif
+#include "esp_netif_sntp.h"
+#include <time.h>
+#if CONFIG_BEACON_MODE
+#include "lwip/sockets.h"
+#endif
+#if CONFIG_BEACON_MODE || CONFIG_ESPNOW_MODE_LEAF
+#include "esp_mac.h"
+#endif
+#if CONFIG_ESPNOW_MODE_LEAF || CONFIG_ESPNOW_MODE_RELAY
+#include "espnow_link.h"
+#endif
 
 #define TAG "temcontrol"
 
 // GPIO configuration from menuconfig
+#if CONFIG_SENSOR_DRIVER_DHT22
 #define DHT_GPIO CONFIG_GPIO_DHT
+#define SENSOR_COUNT CONFIG_SENSOR_COUNT
+#else
+#define SENSOR_COUNT 1      // one SHT3x per node
+#endif
 #define RELAY_GPIO CONFIG_GPIO_RELAY
 #define LED_GPIO CONFIG_GPIO_LED
 
@@ -39,12 +73,14 @@
 #define DHT_TIMEOUT_US 10000
 #define DHT_START_SIGNAL_US 18000
 #define DHT_RESPONSE_SIGNAL_US 40
+#define DHT_BIT_THRESHOLD_US 40  // high pulse longer than this is a 1
 
 // Add these defines after existing ones
 #define AP_SSID "ESP-Config"
 #define AP_PASS "configure123"
 #define AP_MAX_CONNECTIONS 1
 #define WIFI_CONNECT_TIMEOUT_MS 10000
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000  // directed single-channel attempt
 
 // Add these globals after existing ones
 static bool is_ap_mode = false;
@@ -71,6 +107,18 @@ static const char *config_html = "<!DOCTYPE html><html>"
 static EventGroupHandle_t wifi_event_group;
 static httpd_handle_t server = NULL;
 
+// Cached WiFi scan results. /api/scan kicks off a non-blocking scan and
+// answers from this cache immediately, so the single httpd worker is never
+// stuck in a ~6 s blocking passive scan while other endpoints time out.
+// The cache is refreshed from WIFI_EVENT_SCAN_DONE in wifi_event_handler().
+#define SCAN_CACHE_MAX_APS 20
+
+static char scan_cache_ssids[SCAN_CACHE_MAX_APS][33];
+static int scan_cache_count = 0;
+static int64_t scan_cache_time_us = -1;   // -1: never scanned
+static bool scan_in_progress = false;
+static portMUX_TYPE scan_cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Timer structure
 typedef struct {
     bool enabled;
@@ -88,32 +136,375 @@ static timer_config_t relay_timer = {
     .current_state = false
 };
 
+// Guards relay_timer and the humidity controller state below. Both are
+// written from the httpd workers (core 0) and read-modify-written from
+// the esp_timer service task and sampling task (core 1); a POST landing
+// mid-evaluation used to produce a torn duration/last_toggle pair and a
+// relay stuck on for one extra period. Writers take the lock for the
+// few-instruction update, readers take a snapshot — same pattern as
+// sensor_cache_lock. esp_timer and GPIO calls stay outside the lock.
+static portMUX_TYPE relay_state_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Serializes relay_schedule_next()'s stop/start pair across the esp_timer
+// task and httpd workers; held only around the rearm, never the spinlock
+static SemaphoreHandle_t relay_rearm_mutex;
+
+// On-device humidity hysteresis controller. The collector used to close
+// this loop over HTTP (read sensor, compare, POST /api/relay), which
+// added 30-60 s of latency and stopped entirely when WiFi or the
+// collector host went down. Evaluated here against every fresh sample:
+// below the threshold the relay turns on for on_time_s (driving a
+// humidifier, matching the collector's direction), then a cooldown
+// keeps it off for at least cooldown_s. The relay timer has priority,
+// as it did in the collector: the trigger is suppressed while the timer
+// is enabled, and enabling the timer releases an in-flight hold.
+// Settings persist in NVS.
+typedef struct {
+    bool enabled;
+    float threshold;            // percent RH that triggers the relay
+    uint32_t on_time_s;
+    uint32_t cooldown_s;
+    bool active;                // relay currently held on by this controller
+    int64_t cooldown_until_us;  // esp_timer time; triggers ignored before this
+} humidity_ctl_t;
+
+static humidity_ctl_t humidity_ctl = {
+    .enabled = false,
+};
+
+// One-shot timer that ends the on-time, like relay_toggle_timer
+static esp_timer_handle_t humidity_off_timer = NULL;
+
+// Relay schedule (see schedule.h), evaluated every few seconds by a
+// periodic esp_timer. Window entries need the wall clock, so SNTP is
+// started once WiFi is up; until it syncs only interval entries fire.
+// relay_schedule and schedule_last_state are shared between the timer
+// task and httpd workers and guarded by relay_state_lock, same as the
+// relay timer and humidity controller state.
+#define SCHEDULE_EVAL_PERIOD_S 10
+
+static schedule_t relay_schedule;
+static bool schedule_last_state = false;
+static esp_timer_handle_t schedule_eval_timer = NULL;
+
+// mDNS service advertised for connectionless fleet sweeps: the collector
+// browses _labnode._tcp once and reads the latest telemetry of every node
+// from the TXT records, without opening a single HTTP connection.
+#define MDNS_SERVICE_TYPE "_labnode"
+#define MDNS_SERVICE_PROTO "_tcp"
+
+static bool mdns_started = false;
+
+// One-shot esp_timer armed for exactly the next toggle instant. This
+// replaces the old 100 ms polling task: zero wakeups between toggles and
+// jitter bounded by the timer service instead of the poll grid.
+static esp_timer_handle_t relay_toggle_timer = NULL;
+
+// Latest sensor reading, filled by the background sampling task and served
+// directly from RAM by sensor_get_handler(). The DHT22 needs 2 s between
+// reads, so sampling on a fixed period also keeps concurrent HTTP clients
+// from triggering back-to-back transactions the sensor can't service.
+typedef struct {
+    float temperature;
+    float humidity;
+    esp_err_t status;       // result of the last read attempt
+    int64_t timestamp_us;   // esp_timer time of the last successful read
+    bool valid;             // at least one successful read since boot
+} sensor_cache_t;
+
+#if CONFIG_SENSOR_DRIVER_DHT22
+// Attached sensors; the primary sensor (index 0) feeds the history buffer,
+// SSE stream and mDNS telemetry. Additional sensors are sampled on the same
+// period, staggered so the reads interleave instead of queuing.
+static const gpio_num_t sensor_gpios[SENSOR_COUNT] = {
+    CONFIG_GPIO_DHT,
+#if SENSOR_COUNT >= 2
+    CONFIG_GPIO_DHT2,
+#endif
+#if SENSOR_COUNT >= 3
+    CONFIG_GPIO_DHT3,
+#endif
+#if SENSOR_COUNT >= 4
+    CONFIG_GPIO_DHT4,
+#endif
+};
+#endif // CONFIG_SENSOR_DRIVER_DHT22
+
+static sensor_cache_t sensor_caches[SENSOR_COUNT];
+static portMUX_TYPE sensor_cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Ring buffer of historical readings, filled by the sampling task. The
+// collector can backfill gaps with GET /api/history?since=<ts> instead of
+// polling every sample, so a WiFi hiccup no longer loses datapoints.
+// Timestamps are seconds since boot (no RTC on these nodes); the collector
+// maps them to wall-clock time using the "uptime" field of the response.
+typedef struct {
+    uint32_t timestamp;     // seconds since boot
+    float temperature;
+    float humidity;
+} history_record_t;
+
+static history_record_t history_buffer[CONFIG_HISTORY_BUFFER_SIZE];
+static size_t history_head = 0;     // next slot to write
+static size_t history_count = 0;    // number of valid records
+static portMUX_TYPE history_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Packed record for the binary wire format (Accept: application/octet-stream).
+// 8 bytes per reading versus ~60 bytes of JSON: centi-degrees and
+// centi-percent RH as int16, timestamp as uint32 seconds since boot.
+// Multi-byte fields are little-endian (ESP32 native order).
+typedef struct __attribute__((packed)) {
+    int16_t temperature;    // centi-degrees C
+    int16_t humidity;       // centi-percent RH
+    uint32_t timestamp;     // seconds since boot
+} binary_record_t;
+
+// True when the client asked for the packed binary format.
+static bool wants_binary(httpd_req_t *req) {
+    char accept[48];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) != ESP_OK) {
+        return false;
+    }
+    return strstr(accept, "application/octet-stream") != NULL;
+}
+
+static void pack_binary_record(binary_record_t *rec, uint32_t timestamp,
+                               float temperature, float humidity) {
+    rec->temperature = (int16_t)(temperature * 100);
+    rec->humidity = (int16_t)(humidity * 100);
+    rec->timestamp = timestamp;
+}
+
+#if CONFIG_BEACON_MODE
+// Telemetry beacon: every primary-sensor sample also goes out as one
+// packed UDP datagram to a multicast group. No connection state, no
+// retransmission stalls — the collector's single socket listener hears
+// the whole fleet, and HTTP stays available for control and backfill.
+// Field order matches BEACON_PACKET ('<IHhhBI') in collector_service.py.
+typedef struct __attribute__((packed)) {
+    uint32_t seq;           // per-boot sequence number, detects loss
+    uint16_t node_id;       // last two bytes of the STA MAC
+    int16_t temperature;    // centi-degrees C
+    int16_t humidity;       // centi-percent RH
+    uint8_t relay;          // current relay level
+    uint32_t uptime_s;      // seconds since boot
+} beacon_packet_t;
+
+static int beacon_socket = -1;
+static struct sockaddr_in beacon_dest;
+static uint32_t beacon_seq = 0;
+
+// Create the socket once at startup; beacon_send_packet() may be called
+// from both the sampling task and the WiFi task (ESP-NOW forwarding)
+static void beacon_init(void) {
+    beacon_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (beacon_socket < 0) {
+        ESP_LOGW(TAG, "Beacon socket failed, telemetry beacons disabled");
+        return;
+    }
+    uint8_t ttl = 1;    // telemetry stays on the local segment
+    setsockopt(beacon_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    beacon_dest.sin_family = AF_INET;
+    beacon_dest.sin_port = htons(CONFIG_BEACON_PORT);
+    beacon_dest.sin_addr.s_addr = inet_addr(CONFIG_BEACON_MCAST_ADDR);
+}
+
+// Best-effort by design; a dropped datagram shows up as a seq gap and
+// the collector backfills it from /api/history
+static void beacon_send_packet(const beacon_packet_t *packet) {
+    if (beacon_socket < 0) {
+        return;
+    }
+    sendto(beacon_socket, packet, sizeof(*packet), 0,
+           (struct sockaddr *)&beacon_dest, sizeof(beacon_dest));
+}
+
+static void beacon_send(float temperature, float humidity) {
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    beacon_packet_t packet = {
+        .seq = beacon_seq++,
+        .node_id = ((uint16_t)mac[4] << 8) | mac[5],
+        .temperature = (int16_t)(temperature * 100),
+        .humidity = (int16_t)(humidity * 100),
+        .relay = gpio_get_level(RELAY_GPIO) ? 1 : 0,
+        .uptime_s = (uint32_t)(esp_timer_get_time() / 1000000),
+    };
+    beacon_send_packet(&packet);
+}
+#endif // CONFIG_BEACON_MODE
+
+#if CONFIG_ESPNOW_MODE_RELAY
+// Latest reading heard from each leaf node, served by /api/remote and
+// (when beacon mode is on) forwarded to the multicast group so the
+// collector sees out-of-range nodes through the same listener.
+#define REMOTE_MAX_NODES 8
+
+typedef struct {
+    bool used;
+    espnow_reading_t last;
+    int64_t rx_time_us;
+} remote_node_t;
+
+static remote_node_t remote_nodes[REMOTE_MAX_NODES];
+static portMUX_TYPE remote_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Runs in the WiFi task (ESP-NOW receive callback): table update under
+// the spinlock, forwarding outside it
+static void espnow_reading_received(const espnow_reading_t *reading) {
+    portENTER_CRITICAL(&remote_lock);
+    remote_node_t *slot = NULL;
+    for (int i = 0; i < REMOTE_MAX_NODES; i++) {
+        if (remote_nodes[i].used && remote_nodes[i].last.node_id == reading->node_id) {
+            slot = &remote_nodes[i];
+            break;
+        }
+        if (slot == NULL && !remote_nodes[i].used) {
+            slot = &remote_nodes[i];
+        }
+    }
+    if (slot != NULL) {
+        slot->used = true;
+        slot->last = *reading;
+        slot->rx_time_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&remote_lock);
+
+#if CONFIG_BEACON_MODE
+    // Same wire layout, so the leaf's reading forwards unmodified
+    beacon_send_packet((const beacon_packet_t *)reading);
+#endif
+}
+#endif // CONFIG_ESPNOW_MODE_RELAY
+
+#if CONFIG_HISTORY_FLASH
+// Flash records carry epoch seconds once SNTP has synced (stable across
+// reboots, which is the point of the flash store); before that, uptime.
+// Epoch values are far above any plausible uptime, so the collector can
+// tell the two apart.
+static uint32_t flash_history_timestamp(uint32_t uptime_s) {
+    time_t now = time(NULL);
+    return (now > 1600000000) ? (uint32_t)now : uptime_s;
+}
+#endif
+
+static void history_append(uint32_t timestamp, float temperature, float humidity) {
+    portENTER_CRITICAL(&history_lock);
+    history_buffer[history_head].timestamp = timestamp;
+    history_buffer[history_head].temperature = temperature;
+    history_buffer[history_head].humidity = humidity;
+    history_head = (history_head + 1) % CONFIG_HISTORY_BUFFER_SIZE;
+    if (history_count < CONFIG_HISTORY_BUFFER_SIZE) {
+        history_count++;
+    }
+    portEXIT_CRITICAL(&history_lock);
+}
+
+// Server-sent-event clients. Each connected collector holds one long-lived
+// connection and gets every new sample and relay/timer state change pushed
+// as it happens, instead of polling over fresh TCP+HTTP handshakes.
+#define MAX_SSE_CLIENTS 3
+
+static httpd_req_t *sse_clients[MAX_SSE_CLIENTS];
+static portMUX_TYPE sse_clients_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Serializes sse_broadcast() across its callers (sampling task, esp_timer
+// task, httpd workers). The socket send and any dead-client teardown
+// happen under this mutex, so one caller can never free the async req
+// another caller is still sending on, and frames from concurrent events
+// never interleave on a subscriber's socket. The spinlock above stays a
+// pointer guard only.
+static SemaphoreHandle_t sse_send_mutex;
+
 // Function declarations
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                              int32_t event_id, void* event_data);
-static void initialize_wifi(void);
+static void initialize_wifi_start(void);
+static void wifi_monitor_task(void *pvParameters);
 static esp_err_t sensor_get_handler(httpd_req_t *req);
 static esp_err_t relay_post_handler(httpd_req_t *req);
 static esp_err_t timer_handler(httpd_req_t *req);
+static esp_err_t humidity_handler(httpd_req_t *req);
+static void humidity_control_evaluate(float humidity);
+static void humidity_off_callback(void *arg);
+static void relay_toggle_callback(void *arg);
+static esp_err_t schedule_handler(httpd_req_t *req);
+static void schedule_eval_callback(void *arg);
+#if CONFIG_ESPNOW_MODE_RELAY
+static esp_err_t remote_get_handler(httpd_req_t *req);
+#endif
 static esp_err_t hostname_get_handler(httpd_req_t *req);
 static esp_err_t hostname_post_handler(httpd_req_t *req);
-static void timer_control_task(void *pvParameters);
+static void relay_schedule_next(void);
+#if CONFIG_SENSOR_DRIVER_DHT22
+static void dht_timing_calibrate(void);
+#endif
+static esp_err_t read_sensor_safe(float *temperature, float *humidity);
+static esp_err_t read_sensor_at(int sensor, float *temperature, float *humidity);
+static esp_err_t sensors_get_handler(httpd_req_t *req);
+static void initialize_mdns(void);
+static void mdns_update_telemetry(void);
+static void sensor_sampling_task(void *pvParameters);
+static esp_err_t history_get_handler(httpd_req_t *req);
+static esp_err_t events_get_handler(httpd_req_t *req);
+static esp_err_t ota_post_handler(httpd_req_t *req);
+static void sse_broadcast(const char *event, const char *json);
+static void json_response_begin(json_writer_t *jw, httpd_req_t *req);
+static esp_err_t json_response_end(json_writer_t *jw, httpd_req_t *req);
 
 // Add these new handler declarations after existing ones
 static esp_err_t config_get_handler(httpd_req_t *req);
 static esp_err_t scan_get_handler(httpd_req_t *req);
 static esp_err_t wifi_post_handler(httpd_req_t *req);
 
+// Latency instrumentation: handlers are registered through one trampoline
+// that times the real handler and feeds the per-URI histogram
+typedef struct {
+    metric_uri_t metric;
+    esp_err_t (*handler)(httpd_req_t *req);
+} timed_route_t;
+
+static esp_err_t timed_handler(httpd_req_t *req) {
+    const timed_route_t *route = (const timed_route_t *)req->user_ctx;
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = route->handler(req);
+    metrics_record_latency(route->metric, start);
+    return ret;
+}
+
+static const timed_route_t sensor_route   = { METRIC_URI_SENSOR,   sensor_get_handler };
+static const timed_route_t sensors_route  = { METRIC_URI_SENSOR,   sensors_get_handler };
+static const timed_route_t history_route  = { METRIC_URI_HISTORY,  history_get_handler };
+static const timed_route_t relay_route    = { METRIC_URI_RELAY,    relay_post_handler };
+static const timed_route_t timer_route    = { METRIC_URI_TIMER,    timer_handler };
+static const timed_route_t hostname_route = { METRIC_URI_HOSTNAME, hostname_get_handler };
+static const timed_route_t scan_route     = { METRIC_URI_SCAN,     scan_get_handler };
+static const timed_route_t humidity_route = { METRIC_URI_HUMIDITY, humidity_handler };
+static const timed_route_t schedule_route = { METRIC_URI_SCHEDULE, schedule_handler };
+#if CONFIG_ESPNOW_MODE_RELAY
+static const timed_route_t remote_route    = { METRIC_URI_REMOTE,   remote_get_handler };
+#endif
+
 // Initialize GPIO
 static void initialize_gpio(void) {
     gpio_reset_pin(RELAY_GPIO);
     gpio_reset_pin(LED_GPIO);
-    gpio_reset_pin(DHT_GPIO);
     
-    gpio_set_direction(RELAY_GPIO, GPIO_MODE_OUTPUT);
+    // INPUT_OUTPUT so the current relay level can be read back
+    gpio_set_direction(RELAY_GPIO, GPIO_MODE_INPUT_OUTPUT);
     gpio_set_direction(LED_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
-    gpio_pullup_en(DHT_GPIO);  // Enable pullup for DHT
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        sensor_caches[i].status = ESP_ERR_INVALID_STATE;  // no read yet
+    }
+#if CONFIG_SENSOR_DRIVER_DHT22
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        gpio_reset_pin(sensor_gpios[i]);
+        gpio_set_direction(sensor_gpios[i], GPIO_MODE_INPUT);
+        gpio_pullup_en(sensor_gpios[i]);  // Enable pullup for DHT
+    }
+#endif
     
     gpio_set_level(RELAY_GPIO, 0);
     gpio_set_level(LED_GPIO, 0);
@@ -123,28 +514,107 @@ static void initialize_gpio(void) {
 static const httpd_uri_t sensor_uri = {
     .uri       = "/api/sensor",
     .method    = HTTP_GET,
-    .handler   = sensor_get_handler,
-    .user_ctx  = NULL
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&sensor_route
+};
+
+static const httpd_uri_t sensors_uri = {
+    .uri       = "/api/sensors",
+    .method    = HTTP_GET,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&sensors_route
 };
 
 static const httpd_uri_t relay_uri = {
     .uri       = "/api/relay",
     .method    = HTTP_POST,
-    .handler   = relay_post_handler,
-    .user_ctx  = NULL
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&relay_route
 };
 
 static const httpd_uri_t timer_uri = {
     .uri       = "/api/timer",
     .method    = HTTP_GET,    // Changed to GET
-    .handler   = timer_handler,
-    .user_ctx  = NULL
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&timer_route
 };
 
 static const httpd_uri_t timer_post_uri = {    // Added new URI for POST
     .uri       = "/api/timer",
     .method    = HTTP_POST,
-    .handler   = timer_handler,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&timer_route
+};
+
+static const httpd_uri_t humidity_uri = {
+    .uri       = "/api/humidity",
+    .method    = HTTP_GET,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&humidity_route
+};
+
+static const httpd_uri_t humidity_post_uri = {
+    .uri       = "/api/humidity",
+    .method    = HTTP_POST,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&humidity_route
+};
+
+static const httpd_uri_t schedule_uri = {
+    .uri       = "/api/schedule",
+    .method    = HTTP_GET,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&schedule_route
+};
+
+static const httpd_uri_t schedule_post_uri = {
+    .uri       = "/api/schedule",
+    .method    = HTTP_POST,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&schedule_route
+};
+
+#if CONFIG_ESPNOW_MODE_RELAY
+static const httpd_uri_t remote_uri = {
+    .uri       = "/api/remote",
+    .method    = HTTP_GET,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&remote_route
+};
+#endif
+
+static const httpd_uri_t history_uri = {
+    .uri       = "/api/history",
+    .method    = HTTP_GET,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&history_route
+};
+
+static const httpd_uri_t ota_uri = {
+    .uri       = "/api/ota",
+    .method    = HTTP_POST,
+    .handler   = ota_post_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t metrics_uri = {
+    .uri       = "/api/metrics",
+    .method    = HTTP_GET,
+    .handler   = metrics_get_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t logs_uri = {
+    .uri       = "/api/logs",
+    .method    = HTTP_GET,
+    .handler   = log_ring_get_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t events_uri = {
+    .uri       = "/api/events",
+    .method    = HTTP_GET,
+    .handler   = events_get_handler,
     .user_ctx  = NULL
 };
 
@@ -152,8 +622,8 @@ static const httpd_uri_t timer_post_uri = {    // Added new URI for POST
 static const httpd_uri_t hostname_get_uri = {
     .uri       = "/api/hostname",
     .method    = HTTP_GET,
-    .handler   = hostname_get_handler,
-    .user_ctx  = NULL
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&hostname_route
 };
 
 static const httpd_uri_t hostname_post_uri = {
@@ -173,7 +643,8 @@ static const httpd_uri_t config_uri = {
 static const httpd_uri_t scan_uri = {
     .uri       = "/api/scan",
     .method    = HTTP_GET,
-    .handler   = scan_get_handler,
+    .handler   = timed_handler,
+    .user_ctx  = (void *)&scan_route,
 };
 
 static const httpd_uri_t wifi_uri = {
@@ -185,7 +656,27 @@ static const httpd_uri_t wifi_uri = {
 // Start HTTP server
 static httpd_handle_t start_webserver(void) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    
+
+    // Deliberate core layout: all networking (WiFi task, lwIP, httpd)
+    // on PRO_CPU, sensing and relay control on APP_CPU (see app_main).
+    // The DHT fallback's interrupt masking then only ever stalls core 1,
+    // never the WiFi stack.
+    config.core_id = 0;
+    config.max_uri_handlers = 24;
+
+    // Multi-client profile: enough sockets for the dashboard, collector,
+    // SSE subscribers and ad-hoc curl at once, LRU purge so an idle client
+    // never causes connection-refused, and timeouts/keep-alive so stalled
+    // or dead peers release their sockets. Sized via menuconfig.
+    config.max_open_sockets = CONFIG_HTTPD_MAX_OPEN_SOCKETS;
+    config.lru_purge_enable = true;
+    config.recv_wait_timeout = CONFIG_HTTPD_RECV_TIMEOUT_S;
+    config.send_wait_timeout = CONFIG_HTTPD_SEND_TIMEOUT_S;
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = CONFIG_HTTPD_KEEP_ALIVE_IDLE_S;
+    config.keep_alive_interval = 5;
+    config.keep_alive_count = 3;
+
     if (httpd_start(&server, &config) == ESP_OK) {
         if (is_ap_mode) {
             // AP mode handlers
@@ -195,9 +686,22 @@ static httpd_handle_t start_webserver(void) {
         } else {
             // Normal mode handlers
             httpd_register_uri_handler(server, &sensor_uri);
+            httpd_register_uri_handler(server, &sensors_uri);
+            httpd_register_uri_handler(server, &history_uri);
+            httpd_register_uri_handler(server, &events_uri);
+            httpd_register_uri_handler(server, &ota_uri);
+            httpd_register_uri_handler(server, &metrics_uri);
+            httpd_register_uri_handler(server, &logs_uri);
             httpd_register_uri_handler(server, &relay_uri);
             httpd_register_uri_handler(server, &timer_uri);        // Register GET handler
             httpd_register_uri_handler(server, &timer_post_uri);   // Register POST handler
+            httpd_register_uri_handler(server, &humidity_uri);
+            httpd_register_uri_handler(server, &humidity_post_uri);
+            httpd_register_uri_handler(server, &schedule_uri);
+            httpd_register_uri_handler(server, &schedule_post_uri);
+#if CONFIG_ESPNOW_MODE_RELAY
+            httpd_register_uri_handler(server, &remote_uri);
+#endif
             httpd_register_uri_handler(server, &hostname_get_uri);
             httpd_register_uri_handler(server, &hostname_post_uri);
         }
@@ -208,6 +712,9 @@ static httpd_handle_t start_webserver(void) {
 
 // Main application
 void app_main(void) {
+    // Capture log output from the first line on
+    log_ring_init();
+
     // Initialize NVS
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -215,18 +722,156 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    metrics_boot_stage("nvs");
+
+    // Load configuration into the RAM cache; all later reads skip flash
+    ESP_ERROR_CHECK(config_store_init());
+
+    // Apply persisted timer defaults
+    config_timer_defaults_t timer_defaults;
+    config_store_get_timer(&timer_defaults);
+    relay_timer.enabled = timer_defaults.enabled;
+    relay_timer.on_duration = timer_defaults.on_duration_ms;
+    relay_timer.off_duration = timer_defaults.off_duration_ms;
+    relay_timer.last_toggle = 0;
+
+    // Restore the humidity controller; it survives reboots and network
+    // outages, unlike the old collector-side loop
+    config_humidity_ctl_t humidity_cfg;
+    config_store_get_humidity_ctl(&humidity_cfg);
+    humidity_ctl.enabled = humidity_cfg.enabled;
+    humidity_ctl.threshold = humidity_cfg.threshold;
+    humidity_ctl.on_time_s = humidity_cfg.on_time_s;
+    humidity_ctl.cooldown_s = humidity_cfg.cooldown_s;
+
+    // Restore the relay schedule
+    config_store_get_schedule(&relay_schedule);
+
+#if CONFIG_HISTORY_FLASH
+    // Bring up the persistent history log; with no 'history' partition
+    // the node just falls back to the RAM ring
+    flash_store_init();
+#endif
 
     // Initialize GPIO
     initialize_gpio();
-    
-    // Initialize WiFi
-    initialize_wifi();
-    
+
+#if CONFIG_SENSOR_DRIVER_DHT22
+    dht_timing_calibrate();
+    // Claim an RMT channel per sensor; falls back to bit-banging if none free
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        dht_rmt_init(sensor_gpios[i]);
+    }
+#else
+    // I2C sensor: a failed probe is logged but not fatal; reads will keep
+    // reporting the error until the sensor appears on the bus
+    sht3x_init();
+#endif
+    metrics_boot_stage("drivers");
+
+#if CONFIG_ESPNOW_MODE_LEAF
+    // Out-of-range node: no association, no IP stack use. Bring the radio
+    // up on the fixed ESP-NOW channel and push every sample peer-to-peer
+    // to whichever in-range relay hears it.
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_sta();
+    wifi_init_config_t espnow_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&espnow_cfg));
+    ESP_ERROR_CHECK(espnow_link_init_leaf());
+
+    uint8_t leaf_mac[6];
+    esp_read_mac(leaf_mac, ESP_MAC_WIFI_STA);
+    uint32_t leaf_seq = 0;
+
+    while (1) {
+        float temperature = 0, humidity = 0;
+        if (read_sensor_safe(&temperature, &humidity) == ESP_OK) {
+            espnow_reading_t reading = {
+                .seq = leaf_seq++,
+                .node_id = ((uint16_t)leaf_mac[4] << 8) | leaf_mac[5],
+                .temperature = (int16_t)(temperature * 100),
+                .humidity = (int16_t)(humidity * 100),
+                .relay = gpio_get_level(RELAY_GPIO) ? 1 : 0,
+                .uptime_s = (uint32_t)(esp_timer_get_time() / 1000000),
+            };
+            espnow_link_send(&reading);
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_SENSOR_SAMPLE_PERIOD_S * 1000));
+    }
+#endif
+
+#ifdef CONFIG_BATTERY_MODE
+    // Battery node: no HTTP server, no always-on WiFi. Prepare the WiFi
+    // driver (started/stopped by the scheduler around each flush) and hand
+    // over to the duty-cycled sample/sleep loop.
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_sta();
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    power_scheduler_run(read_sensor_safe);
+#endif
+
+    // Fast-boot profile: kick off the WiFi association and immediately
+    // continue to httpd and sampling, serving cached/flash data before
+    // the node even has an address. wifi_monitor_task() finishes the
+    // bring-up (mDNS, SNTP, provisioning fallback) off the boot path.
+    initialize_wifi_start();
+    metrics_boot_stage("wifi_start");
+
     // Start HTTP server
+    sse_send_mutex = xSemaphoreCreateMutex();
+    relay_rearm_mutex = xSemaphoreCreateMutex();
     start_webserver();
-    
-    // Start timer control task
-    xTaskCreate(timer_control_task, "timer_control", 2048, NULL, 5, NULL);
+    metrics_boot_stage("httpd");
+
+    xTaskCreatePinnedToCore(wifi_monitor_task, "wifi_monitor", 4096,
+                            NULL, 5, NULL, 0);
+
+#if CONFIG_BEACON_MODE
+    beacon_init();
+#endif
+
+    // Relay toggle timer: one-shot, re-armed after each toggle
+    const esp_timer_create_args_t toggle_timer_args = {
+        .callback = relay_toggle_callback,
+        .name = "relay_toggle"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&toggle_timer_args, &relay_toggle_timer));
+    relay_schedule_next();
+
+    const esp_timer_create_args_t humidity_off_args = {
+        .callback = humidity_off_callback,
+        .name = "humidity_off"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&humidity_off_args, &humidity_off_timer));
+
+    const esp_timer_create_args_t schedule_eval_args = {
+        .callback = schedule_eval_callback,
+        .name = "schedule_eval"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&schedule_eval_args, &schedule_eval_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(schedule_eval_timer,
+                                             (uint64_t)SCHEDULE_EVAL_PERIOD_S * 1000000));
+
+    // Start background sensor sampling task, pinned to APP_CPU so the
+    // DHT transaction (and its interrupt-masked window in the bit-banged
+    // fallback) never contends with the core-0 network stack. The
+    // esp_timer service task (relay toggles, humidity hold, schedule
+    // ticks) is pinned to core 1 via sdkconfig for the same reason.
+    TaskHandle_t sampling_task;
+    xTaskCreatePinnedToCore(sensor_sampling_task, "sensor_sampling", 3072,
+                            NULL, 5, &sampling_task, 1);
+    metrics_watch_task(sampling_task);
+    metrics_boot_stage("sampling");
+
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+    // We made it through startup: commit this image so the bootloader
+    // doesn't roll back to the previous partition on the next reset
+    esp_ota_mark_app_valid_cancel_rollback();
+#endif
 }
 
 // WiFi event handler
@@ -234,6 +879,35 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                              int32_t event_id, void* event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        // Harvest the finished scan into the cache (runs in the event task,
+        // not the httpd worker). The record array is static — ~2 KB of
+        // wifi_ap_record_t would blow the event task's small stack, and
+        // only one scan is ever in flight (scan_in_progress)
+        static wifi_ap_record_t ap_records[SCAN_CACHE_MAX_APS];
+        uint16_t ap_count = SCAN_CACHE_MAX_APS;
+        if (esp_wifi_scan_get_ap_records(&ap_count, ap_records) == ESP_OK) {
+            portENTER_CRITICAL(&scan_cache_lock);
+            scan_cache_count = ap_count;
+            for (int i = 0; i < ap_count; i++) {
+                strncpy(scan_cache_ssids[i], (char *)ap_records[i].ssid,
+                        sizeof(scan_cache_ssids[i]) - 1);
+                scan_cache_ssids[i][sizeof(scan_cache_ssids[i]) - 1] = '\0';
+            }
+            scan_cache_time_us = esp_timer_get_time();
+            scan_in_progress = false;
+            portEXIT_CRITICAL(&scan_cache_lock);
+            ESP_LOGI(TAG, "Scan done: %d networks cached", ap_count);
+        } else {
+            portENTER_CRITICAL(&scan_cache_lock);
+            scan_in_progress = false;
+            portEXIT_CRITICAL(&scan_cache_lock);
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        // Remember where we associated for directed reconnect on next boot
+        // (config_store skips the flash write when nothing changed)
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *) event_data;
+        config_store_set_ap_hint(event->bssid, event->channel);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         gpio_set_level(LED_GPIO, 1); // LED on when disconnected
         esp_wifi_connect();
@@ -253,46 +927,57 @@ static esp_err_t config_get_handler(httpd_req_t *req) {
 }
 
 static esp_err_t scan_get_handler(httpd_req_t *req) {
-    wifi_scan_config_t scan_config = {
-        .show_hidden = true,
-        .scan_type = WIFI_SCAN_TYPE_PASSIVE,
-        .scan_time.passive = 500
-    };
-    
-    // Start scan
-    ESP_ERROR_CHECK(esp_wifi_scan_start(&scan_config, true));
-    
-    // Get results
-    uint16_t ap_count = 0;
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
-    if (ap_count > 20) ap_count = 20;
-    
-    wifi_ap_record_t ap_records[20];
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ap_count, ap_records));
-    
-    // Build JSON response
-    char *response = malloc(2048);
-    strcpy(response, "{\"networks\":[");
-    
-    for (int i = 0; i < ap_count; i++) {
-        if (i > 0) strcat(response, ",");
-        strcat(response, "\"");
-        strcat(response, (char *)ap_records[i].ssid);
-        strcat(response, "\"");
+    // Kick off a background refresh unless one is already running; the
+    // results land in the cache via WIFI_EVENT_SCAN_DONE
+    portENTER_CRITICAL(&scan_cache_lock);
+    bool start_scan = !scan_in_progress;
+    if (start_scan) {
+        scan_in_progress = true;
     }
-    strcat(response, "]}");
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, response, strlen(response));
-    free(response);
-    
-    return ESP_OK;
+    portEXIT_CRITICAL(&scan_cache_lock);
+
+    if (start_scan) {
+        wifi_scan_config_t scan_config = {
+            .show_hidden = true,
+            .scan_type = WIFI_SCAN_TYPE_PASSIVE,
+            .scan_time.passive = 500
+        };
+        if (esp_wifi_scan_start(&scan_config, false) != ESP_OK) {
+            portENTER_CRITICAL(&scan_cache_lock);
+            scan_in_progress = false;
+            portEXIT_CRITICAL(&scan_cache_lock);
+        }
+    }
+
+    // Answer immediately from the cache; the client polls again once
+    // "scanning" clears or "age" drops
+    portENTER_CRITICAL(&scan_cache_lock);
+    int count = scan_cache_count;
+    int64_t cache_time = scan_cache_time_us;
+    bool scanning = scan_in_progress;
+    char ssids[SCAN_CACHE_MAX_APS][33];
+    memcpy(ssids, scan_cache_ssids, sizeof(ssids));
+    portEXIT_CRITICAL(&scan_cache_lock);
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_array_begin(&jw, "networks");
+    for (int i = 0; i < count; i++) {
+        json_writer_string(&jw, NULL, ssids[i]);
+    }
+    json_writer_array_end(&jw);
+    if (cache_time >= 0) {
+        json_writer_uint(&jw, "age", (esp_timer_get_time() - cache_time) / 1000000);
+    }
+    json_writer_bool(&jw, "scanning", scanning);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
 }
 
 static esp_err_t wifi_post_handler(httpd_req_t *req) {
     char buf[128];
-    nvs_handle_t nvs_handle;
-    
+
     int ret = httpd_req_recv(req, buf, sizeof(buf));
     if (ret <= 0) return ESP_FAIL;
     buf[ret] = '\0';
@@ -300,104 +985,106 @@ static esp_err_t wifi_post_handler(httpd_req_t *req) {
     // Parse JSON (simple parsing)
     char ssid[33] = {0};
     char pass[65] = {0};
-    char *ssid_start = strstr(buf, "\"ssid\":\"");
-    char *pass_start = strstr(buf, "\"pass\":\"");
-    
-    if (ssid_start && pass_start) {
-        ssid_start += 8;
-        pass_start += 8;
-        char *ssid_end = strchr(ssid_start, '"');
-        char *pass_end = strchr(pass_start, '"');
-        
-        if (ssid_end && pass_end) {
-            strncpy(ssid, ssid_start, ssid_end - ssid_start);
-            strncpy(pass, pass_start, pass_end - pass_start);
-            
-            // Store in NVS
-            ESP_ERROR_CHECK(nvs_open("storage", NVS_READWRITE, &nvs_handle));
-            ESP_ERROR_CHECK(nvs_set_str(nvs_handle, "wifi_ssid", ssid));
-            ESP_ERROR_CHECK(nvs_set_str(nvs_handle, "wifi_pass", pass));
-            ESP_ERROR_CHECK(nvs_commit(nvs_handle));
-            nvs_close(nvs_handle);
-            
-            httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
-            
-            // Delay restart to allow response to be sent
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            esp_restart();
-            return ESP_OK;
-        }
+
+    if (parse_wifi_credentials(buf, ssid, sizeof(ssid), pass, sizeof(pass))) {
+        // Cache + write-through to NVS (one commit for both keys)
+        ESP_ERROR_CHECK(config_store_set_wifi(ssid, pass));
+
+        httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+        // Delay restart to allow response to be sent
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+        return ESP_OK;
     }
-    
+
     httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
     return ESP_FAIL;
 }
 
 // Initialize WiFi
-static void initialize_wifi(void) {
+// Whether boot attempted a station association, and with a directed hint
+static bool wifi_sta_attempted = false;
+static bool wifi_hint_used = false;
+
+// Begin WiFi bring-up without blocking boot: interfaces, driver, and
+// (when credentials exist) the first association attempt. Everything
+// after the esp_wifi_start() handshake happens in wifi_monitor_task(),
+// so httpd and sampling come up while the radio is still associating.
+// The AP netif is NOT created here; provisioning mode is rare, and on
+// the 60-node rejoin-after-power-blip path its creation was pure waste.
+static void initialize_wifi_start(void) {
     wifi_event_group = xEventGroupCreate();
-    
+
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    
-    // Create default STA and AP interfaces
+
     esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
-    ap_netif = esp_netif_create_default_wifi_ap();
-    
+
+#ifdef CONFIG_STATIC_IP
+    // Fixed address: skip the DHCP handshake entirely
+    esp_netif_dhcpc_stop(sta_netif);
+    esp_netif_ip_info_t ip_info = {0};
+    ip_info.ip.addr = esp_ip4addr_aton(CONFIG_STATIC_IP_ADDR);
+    ip_info.gw.addr = esp_ip4addr_aton(CONFIG_STATIC_IP_GATEWAY);
+    ip_info.netmask.addr = esp_ip4addr_aton(CONFIG_STATIC_IP_NETMASK);
+    ESP_ERROR_CHECK(esp_netif_set_ip_info(sta_netif, &ip_info));
+#else
+    (void)sta_netif;
+#endif
+
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    
+
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
-    
-    // Try to load saved credentials
-    nvs_handle_t nvs_handle;
-    char ssid[33] = {0};
-    char pass[65] = {0};
-    size_t len = sizeof(ssid);
-    
-    if (nvs_open("storage", NVS_READONLY, &nvs_handle) == ESP_OK) {
-        if (nvs_get_str(nvs_handle, "wifi_ssid", ssid, &len) == ESP_OK) {
-            len = sizeof(pass);
-            if (nvs_get_str(nvs_handle, "wifi_pass", pass, &len) == ESP_OK) {
-                // Configure station with saved credentials
-                wifi_config_t wifi_config = {
-                    .sta = {
-                        .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-                        .pmf_cfg = {
-                            .capable = true,
-                            .required = false
-                        },
-                    },
-                };
-                strcpy((char *)wifi_config.sta.ssid, ssid);
-                strcpy((char *)wifi_config.sta.password, pass);
-                
-                ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-                ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
-                ESP_ERROR_CHECK(esp_wifi_start());
-                
-                // Wait for connection
-                EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
-                    WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                    pdFALSE,
-                    pdFALSE,
-                    pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
-                
-                if (bits & WIFI_CONNECTED_BIT) {
-                    ESP_LOGI(TAG, "Connected to saved network");
-                    nvs_close(nvs_handle);
-                    return;
-                }
-            }
-        }
-        nvs_close(nvs_handle);
+
+    // Try saved credentials from the config cache (loaded once at boot)
+    char ssid[CONFIG_STORE_SSID_LEN] = {0};
+    char pass[CONFIG_STORE_PASS_LEN] = {0};
+
+    if (!config_store_get_wifi(ssid, sizeof(ssid), pass, sizeof(pass))) {
+        return;     // monitor task goes straight to provisioning
     }
-    
-    // If we get here, either no saved credentials or connection failed
+
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .pmf_cfg = {
+                .capable = true,
+                .required = false
+            },
+        },
+    };
+    strcpy((char *)wifi_config.sta.ssid, ssid);
+    strcpy((char *)wifi_config.sta.password, pass);
+
+    // Directed reconnect first: target the last known BSSID on its
+    // channel instead of scanning all channels. The monitor task falls
+    // back to a full scan if the AP moved or changed channel.
+    uint8_t bssid[6];
+    uint8_t channel = 0;
+    wifi_hint_used = config_store_get_ap_hint(bssid, &channel);
+    if (wifi_hint_used) {
+        memcpy(wifi_config.sta.bssid, bssid, 6);
+        wifi_config.sta.bssid_set = true;
+        wifi_config.sta.channel = channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+    }
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    wifi_sta_attempted = true;
+}
+
+// Fall back to the provisioning AP: create the AP netif (deferred from
+// boot), switch modes, and restart httpd with the config handlers
+static void start_provisioning_ap(void) {
     ESP_LOGI(TAG, "Starting AP mode");
     is_ap_mode = true;
-    
+    ap_netif = esp_netif_create_default_wifi_ap();
+
     wifi_config_t ap_config = {
         .ap = {
             .ssid = AP_SSID,
@@ -407,15 +1094,132 @@ static void initialize_wifi(void) {
             .authmode = WIFI_AUTH_WPA_WPA2_PSK
         },
     };
-    
+
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_AP, &ap_config));
     ESP_ERROR_CHECK(esp_wifi_start());
-    
-    // Start configuration web server
+
+    // The early-boot server registered the normal-mode handlers;
+    // restart it with the provisioning set
+    if (server != NULL) {
+        httpd_stop(server);
+        server = NULL;
+    }
     start_webserver();
 }
 
+// Finishes WiFi bring-up off the boot path: waits out the association
+// attempt, retries with a full scan when the directed hint fails, and
+// only then either starts the network-dependent services or falls back
+// to provisioning. Deletes itself when done.
+static void wifi_monitor_task(void *pvParameters) {
+    if (wifi_sta_attempted) {
+        EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+            pdFALSE,
+            pdFALSE,
+            pdMS_TO_TICKS(wifi_hint_used ? WIFI_FAST_CONNECT_TIMEOUT_MS
+                                         : WIFI_CONNECT_TIMEOUT_MS));
+
+        if (!(bits & WIFI_CONNECTED_BIT) && wifi_hint_used) {
+            // Hint didn't pan out; retry with a full all-channel scan
+            ESP_LOGI(TAG, "Directed reconnect failed, falling back to full scan");
+            wifi_config_t wifi_config;
+            ESP_ERROR_CHECK(esp_wifi_get_config(ESP_IF_WIFI_STA, &wifi_config));
+            wifi_config.sta.bssid_set = false;
+            wifi_config.sta.channel = 0;
+            wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+            ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+            esp_wifi_connect();
+
+            bits = xEventGroupWaitBits(wifi_event_group,
+                WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                pdFALSE,
+                pdFALSE,
+                pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+        }
+
+        if (bits & WIFI_CONNECTED_BIT) {
+            ESP_LOGI(TAG, "Connected to saved network");
+            metrics_boot_stage("wifi_ip");
+
+            initialize_mdns();
+
+            // Wall clock for schedule windows; interval entries and the
+            // rest of the firmware keep working while this never syncs
+            setenv("TZ", CONFIG_SCHEDULE_TZ, 1);
+            tzset();
+            esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_SNTP_SERVER);
+            sntp_config.start = true;
+            esp_netif_sntp_init(&sntp_config);
+
+#if CONFIG_ESPNOW_MODE_RELAY
+            // Hear leaf nodes on top of the station interface
+            espnow_link_init_relay(espnow_reading_received);
+#endif
+            vTaskDelete(NULL);
+        }
+    }
+
+    // No saved credentials or connection failed
+    start_provisioning_ap();
+    vTaskDelete(NULL);
+}
+
+// Bring up mDNS and advertise the _labnode._tcp service. Telemetry TXT
+// records are filled in by mdns_update_telemetry() as samples arrive.
+static void initialize_mdns(void) {
+    char hostname[32];
+    config_store_get_hostname(hostname, sizeof(hostname));
+
+    esp_err_t err = mdns_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mdns_init failed: %s", esp_err_to_name(err));
+        return;
+    }
+    mdns_hostname_set(hostname);
+    mdns_instance_name_set(hostname);
+
+    mdns_txt_item_t txt[] = {
+        {"temperature", "nan"},
+        {"humidity", "nan"},
+        {"relay", "off"},
+        {"age", "-1"},
+    };
+    ESP_ERROR_CHECK(mdns_service_add(NULL, MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO,
+                                     80, txt, sizeof(txt) / sizeof(txt[0])));
+    mdns_started = true;
+    ESP_LOGI(TAG, "mDNS service %s.%s advertised as %s",
+             MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, hostname);
+}
+
+// Refresh the TXT records from the sensor cache and relay state
+static void mdns_update_telemetry(void) {
+    if (!mdns_started) {
+        return;
+    }
+
+    portENTER_CRITICAL(&sensor_cache_lock);
+    sensor_cache_t cached = sensor_caches[0];
+    portEXIT_CRITICAL(&sensor_cache_lock);
+
+    char value[16];
+    if (cached.valid) {
+        snprintf(value, sizeof(value), "%.1f", cached.temperature);
+        mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO,
+                                  "temperature", value);
+        snprintf(value, sizeof(value), "%.1f", cached.humidity);
+        mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO,
+                                  "humidity", value);
+        snprintf(value, sizeof(value), "%u",
+                 (uint32_t)((esp_timer_get_time() - cached.timestamp_us) / 1000000));
+        mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO,
+                                  "age", value);
+    }
+    mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, "relay",
+                              gpio_get_level(RELAY_GPIO) ? "on" : "off");
+}
+
 // Add helper function for JSON string creation
 static void create_json_response(char* buffer, size_t size, const char* format, ...) {
     va_list args;
@@ -424,54 +1228,160 @@ static void create_json_response(char* buffer, size_t size, const char* format,
     va_end(args);
 }
 
-static void dht_send_start_signal(void) {
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(DHT_GPIO, 0);
-    esp_rom_delay_us(DHT_START_SIGNAL_US);
-    gpio_set_level(DHT_GPIO, 1);
-    esp_rom_delay_us(40);
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
+// Adapters wiring the streaming JSON writer to chunked httpd responses
+static esp_err_t json_flush_to_httpd(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
 }
 
-static esp_err_t dht_wait_for_level(int level, int timeout_us) {
-    int tries = 0;
-    while (gpio_get_level(DHT_GPIO) != level) {
-        if (tries++ > timeout_us) {
-            return ESP_ERR_TIMEOUT;
-        }
-        esp_rom_delay_us(1);
+static void json_response_begin(json_writer_t *jw, httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/json");
+    json_writer_init(jw, json_flush_to_httpd, req);
+}
+
+static esp_err_t json_response_end(json_writer_t *jw, httpd_req_t *req) {
+    esp_err_t err = json_writer_finish(jw);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return err;
+}
+
+#if CONFIG_SENSOR_DRIVER_DHT22
+// The fallback transaction path lives in IRAM and times pulses with the
+// CPU cycle counter. The old code counted esp_rom_delay_us(1) loop
+// iterations as a microsecond proxy; any flash-cache miss stalled the
+// loop and skewed the measurement, which showed up as CRC-failure bursts
+// correlated with OTA and other flash activity. Cycle counts are immune
+// to that, and IRAM placement keeps the code itself off the cache.
+// GPIO reads go through the gpio_ll inline layer so no flash-resident
+// driver call sits inside the timed loop.
+
+static uint32_t dht_cycles_per_us;
+
+// Measure the cycle counter against the ROM microsecond delay once at
+// boot (interrupt jitter averages out over the 1 ms window).
+static void dht_timing_calibrate(void) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    esp_rom_delay_us(1000);
+    dht_cycles_per_us = (esp_cpu_get_cycle_count() - start) / 1000;
+    ESP_LOGI(TAG, "DHT timing calibrated: %u cycles/us", (unsigned)dht_cycles_per_us);
+}
+
+static IRAM_ATTR void dht_delay_us(uint32_t us) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t cycles = us * dht_cycles_per_us;
+    while (esp_cpu_get_cycle_count() - start < cycles) {
     }
-    return ESP_OK;
 }
 
-static esp_err_t dht_read_byte(uint8_t *data) {
-    *data = 0;
+static IRAM_ATTR void dht_send_start_signal(gpio_num_t gpio) {
+    gpio_set_direction(gpio, GPIO_MODE_OUTPUT);
+    gpio_set_level(gpio, 0);
+    dht_delay_us(DHT_START_SIGNAL_US);
+    gpio_set_level(gpio, 1);
+    dht_delay_us(40);
+    gpio_set_direction(gpio, GPIO_MODE_INPUT);
+}
+
+// Wait for the line to reach the given level. Returns the measured wait
+// in microseconds, or -1 on timeout, so callers can classify bits by the
+// actual pulse width instead of sampling at a fixed offset.
+static IRAM_ATTR int dht_wait_for_level(gpio_num_t gpio, int level, int timeout_us) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t timeout_cycles = (uint32_t)timeout_us * dht_cycles_per_us;
+    while (gpio_ll_get_level(&GPIO, gpio) != level) {
+        uint32_t elapsed = esp_cpu_get_cycle_count() - start;
+        if (elapsed > timeout_cycles) {
+            return -1;
+        }
+    }
+    return (int)((esp_cpu_get_cycle_count() - start) / dht_cycles_per_us);
+}
+
+static IRAM_ATTR esp_err_t dht_read_byte(gpio_num_t gpio, uint8_t *data) {
+    *data = 0;
     for (int i = 0; i < 8; i++) {
-        if (dht_wait_for_level(1, DHT_TIMEOUT_US) != ESP_OK) {
+        if (dht_wait_for_level(gpio, 1, DHT_TIMEOUT_US) < 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+        // The wait for the next low edge doubles as the width measurement
+        // of the high pulse: ~27 us means 0, ~70 us means 1
+        int high_us = dht_wait_for_level(gpio, 0, DHT_TIMEOUT_US);
+        if (high_us < 0) {
             return ESP_ERR_TIMEOUT;
         }
-        esp_rom_delay_us(40); // Wait to see if high pulse is long (1) or short (0)
         *data <<= 1;
-        if (gpio_get_level(DHT_GPIO) == 1) {
+        if (high_us > DHT_BIT_THRESHOLD_US) {
             *data |= 1;
         }
-        if (dht_wait_for_level(0, DHT_TIMEOUT_US) != ESP_OK) {
-            return ESP_ERR_TIMEOUT;
-        }
     }
     return ESP_OK;
 }
+#endif // CONFIG_SENSOR_DRIVER_DHT22
 
-// Replace read_sensor_safe with this version
+// Per-read logging compiles out by default: at one UART line per read
+// the blocking serial write costs more than the sensor transaction, and
+// the outcome is already visible in the metrics counters. Turn on
+// SENSOR_READ_LOGGING for bench debugging.
+#if CONFIG_SENSOR_READ_LOGGING
+#define SENSOR_READ_LOGI(...) ESP_LOGI(TAG, __VA_ARGS__)
+#define SENSOR_READ_LOGE(...) ESP_LOGE(TAG, __VA_ARGS__)
+#else
+#define SENSOR_READ_LOGI(...) ((void)0)
+#define SENSOR_READ_LOGE(...) ((void)0)
+#endif
+
+// Primary-sensor wrapper, kept for the single-sensor callers (battery
+// mode scheduler)
 static esp_err_t read_sensor_safe(float *temperature, float *humidity) {
+    return read_sensor_at(0, temperature, humidity);
+}
+
+#if CONFIG_SENSOR_DRIVER_SHT3X
+// I2C path: a plain millisecond-scale bus transaction, no interrupt
+// masking and no per-GPIO state. The sensor/DHT metric counters are
+// reused; they count reads of whichever driver the node was built with.
+static esp_err_t read_sensor_at(int sensor, float *temperature, float *humidity) {
+    (void)sensor;
+    metrics_counter_inc(METRIC_DHT_READ_ATTEMPTS);
+    esp_err_t ret = sht3x_read(temperature, humidity);
+    if (ret == ESP_OK) {
+        SENSOR_READ_LOGI("Read success: temp=%.1f, humidity=%.1f", *temperature, *humidity);
+    } else if (ret == ESP_ERR_TIMEOUT) {
+        metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+    } else if (ret == ESP_ERR_INVALID_CRC) {
+        metrics_counter_inc(METRIC_DHT_CRC_FAILURES);
+    }
+    return ret;
+}
+#else
+// Replace read_sensor_safe with this version
+static esp_err_t read_sensor_at(int sensor, float *temperature, float *humidity) {
     uint8_t data[5] = {0};
-    
+    gpio_num_t gpio = sensor_gpios[sensor];
+
+    metrics_counter_inc(METRIC_DHT_READ_ATTEMPTS);
+
+    // Preferred path: RMT peripheral captures the pulse train in hardware,
+    // so no interrupt masking is needed and WiFi keeps running during the
+    // transaction. The bit-banged code below remains the fallback for
+    // chips without a free RMT channel.
+    if (dht_rmt_available(gpio)) {
+        esp_err_t ret = dht_rmt_read(gpio, temperature, humidity);
+        if (ret == ESP_OK) {
+            SENSOR_READ_LOGI("Read success: temp=%.1f, humidity=%.1f", *temperature, *humidity);
+        } else if (ret == ESP_ERR_TIMEOUT) {
+            metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+        } else if (ret == ESP_ERR_INVALID_CRC) {
+            metrics_counter_inc(METRIC_DHT_CRC_FAILURES);
+        }
+        return ret;
+    }
+
     // Quick GPIO check first
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
+    gpio_set_direction(gpio, GPIO_MODE_INPUT);
     vTaskDelay(pdMS_TO_TICKS(10));
     
-    if (gpio_get_level(DHT_GPIO) == -1) {
-        ESP_LOGE(TAG, "GPIO read failed");
+    if (gpio_get_level(gpio) == -1) {
+        SENSOR_READ_LOGE("GPIO read failed");
         return ESP_ERR_NOT_FOUND;
     }
     
@@ -479,77 +1389,521 @@ static esp_err_t read_sensor_safe(float *temperature, float *humidity) {
     portDISABLE_INTERRUPTS();
     
     // Send start signal
-    dht_send_start_signal();
+    dht_send_start_signal(gpio);
     
     // Wait for DHT response
-    esp_err_t ret = dht_wait_for_level(0, DHT_TIMEOUT_US);
-    if (ret != ESP_OK) {
+    if (dht_wait_for_level(gpio, 0, DHT_TIMEOUT_US) < 0) {
         portENABLE_INTERRUPTS();
-        ESP_LOGE(TAG, "No response from sensor");
+        metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+        SENSOR_READ_LOGE("No response from sensor");
         return ESP_ERR_NOT_FOUND;
     }
-    
+
     // Wait for DHT to pull up
-    ret = dht_wait_for_level(1, DHT_TIMEOUT_US);
-    if (ret != ESP_OK) {
+    if (dht_wait_for_level(gpio, 1, DHT_TIMEOUT_US) < 0) {
         portENABLE_INTERRUPTS();
-        return ret;
+        metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+        return ESP_ERR_TIMEOUT;
     }
-    
+
     // Wait for DHT to pull down
-    ret = dht_wait_for_level(0, DHT_TIMEOUT_US);
-    if (ret != ESP_OK) {
+    if (dht_wait_for_level(gpio, 0, DHT_TIMEOUT_US) < 0) {
         portENABLE_INTERRUPTS();
-        return ret;
+        metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+        return ESP_ERR_TIMEOUT;
     }
-    
+
     // Read 5 bytes
+    esp_err_t ret;
     for (int i = 0; i < 5; i++) {
-        ret = dht_read_byte(&data[i]);
+        ret = dht_read_byte(gpio, &data[i]);
         if (ret != ESP_OK) {
             portENABLE_INTERRUPTS();
-            ESP_LOGE(TAG, "Failed to read byte %d", i);
+            metrics_counter_inc(METRIC_DHT_READ_TIMEOUTS);
+            SENSOR_READ_LOGE("Failed to read byte %d", i);
             return ret;
         }
     }
-    
+
     portENABLE_INTERRUPTS();
-    
-    // Verify checksum
-    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-        ESP_LOGE(TAG, "Checksum failed");
-        return ESP_ERR_INVALID_CRC;
+
+    // Verify checksum and convert (shared with the RMT path)
+    ret = dht_decode_payload(data, temperature, humidity);
+    if (ret != ESP_OK) {
+        metrics_counter_inc(METRIC_DHT_CRC_FAILURES);
+        SENSOR_READ_LOGE("Checksum failed");
+        return ret;
     }
-    
-    // Convert the data
-    *humidity = data[0] + data[1] * 0.1;
-    *temperature = data[2] + data[3] * 0.1;
-    
-    ESP_LOGI(TAG, "Read success: temp=%.1f, humidity=%.1f", *temperature, *humidity);
+
+    SENSOR_READ_LOGI("Read success: temp=%.1f, humidity=%.1f", *temperature, *humidity);
     return ESP_OK;
 }
+#endif // CONFIG_SENSOR_DRIVER_SHT3X
+
+// Background sampling task: reads every sensor once per period and updates
+// the caches. All HTTP reads are served from the caches, so /api/sensor and
+// /api/sensors never touch the hardware. With several sensors the reads are
+// staggered evenly across the period instead of queued back to back, so
+// each sensor still sees its minimum 2 s between transactions.
+static void sensor_sampling_task(void *pvParameters) {
+    const TickType_t stagger_ticks =
+        pdMS_TO_TICKS(CONFIG_SENSOR_SAMPLE_PERIOD_S * 1000 / SENSOR_COUNT);
 
-// Update the sensor_get_handler to include better error reporting
+    while (1) {
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            float temperature = 0, humidity = 0;
+            esp_err_t ret = read_sensor_at(i, &temperature, &humidity);
+
+            int64_t now_us = esp_timer_get_time();
+
+            portENTER_CRITICAL(&sensor_cache_lock);
+            sensor_caches[i].status = ret;
+            if (ret == ESP_OK) {
+                sensor_caches[i].temperature = temperature;
+                sensor_caches[i].humidity = humidity;
+                sensor_caches[i].timestamp_us = now_us;
+                sensor_caches[i].valid = true;
+            }
+            portEXIT_CRITICAL(&sensor_cache_lock);
+
+            // The primary sensor feeds history, SSE and mDNS as before
+            if (i == 0) {
+                if (ret == ESP_OK) {
+                    humidity_control_evaluate(humidity);
+                    history_append(now_us / 1000000, temperature, humidity);
+#if CONFIG_HISTORY_FLASH
+                    flash_store_append(flash_history_timestamp(now_us / 1000000),
+                                       temperature, humidity);
+#endif
+#if CONFIG_BEACON_MODE
+                    beacon_send(temperature, humidity);
+#endif
+
+                    char json[96];
+                    create_json_response(json, sizeof(json),
+                        "{\"temperature\":%.1f,\"humidity\":%.1f,\"ts\":%u}",
+                        temperature, humidity, (uint32_t)(now_us / 1000000));
+                    sse_broadcast("sample", json);
+                }
+                mdns_update_telemetry();
+            }
+
+            vTaskDelay(stagger_ticks);
+        }
+    }
+}
+
+// Serve the cached reading; this is a sub-millisecond memory read instead
+// of a multi-second DHT transaction.
 static esp_err_t sensor_get_handler(httpd_req_t *req) {
-    float temperature = 0, humidity = 0;
-    esp_err_t ret = read_sensor_safe(&temperature, &humidity);
-    
-    char response[100];
-    if (ret == ESP_OK) {
-        create_json_response(response, sizeof(response), 
-            "{\"temperature\":%.1f,\"humidity\":%.1f,\"status\":\"ok\"}", 
-            temperature, humidity);
+    portENTER_CRITICAL(&sensor_cache_lock);
+    sensor_cache_t cached = sensor_caches[0];
+    portEXIT_CRITICAL(&sensor_cache_lock);
+
+    // Binary mode: one fixed-layout packed record, no formatting at all
+    if (wants_binary(req)) {
+        if (!cached.valid) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No reading yet");
+            return ESP_FAIL;
+        }
+        binary_record_t rec;
+        pack_binary_record(&rec, cached.timestamp_us / 1000000,
+                           cached.temperature, cached.humidity);
+        httpd_resp_set_type(req, "application/octet-stream");
+        httpd_resp_send(req, (const char *)&rec, sizeof(rec));
+        return ESP_OK;
+    }
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    if (cached.valid) {
+        uint32_t age_s = (esp_timer_get_time() - cached.timestamp_us) / 1000000;
+        json_writer_float1(&jw, "temperature", cached.temperature);
+        json_writer_float1(&jw, "humidity", cached.humidity);
+        json_writer_uint(&jw, "age", age_s);
+        json_writer_string(&jw, "status", "ok");
     } else {
-        const char* error_msg = (ret == ESP_ERR_NOT_FOUND) ? 
+        const char* error_msg = (cached.status == ESP_ERR_NOT_FOUND) ?
             "Sensor not connected" : "Failed to read sensor";
-        
-        create_json_response(response, sizeof(response), 
-            "{\"error\":\"%s\",\"status\":\"error\",\"code\":%d}", 
-            error_msg, ret);
+        json_writer_string(&jw, "error", error_msg);
+        json_writer_string(&jw, "status", "error");
+        json_writer_int(&jw, "code", cached.status);
     }
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, response, strlen(response));
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+
+// Batched view of every attached sensor in one round trip: a client polling
+// N sensors makes one request instead of N. Each entry carries its GPIO so
+// the collector can map entries to physical probes.
+static esp_err_t sensors_get_handler(httpd_req_t *req) {
+    sensor_cache_t snapshot[SENSOR_COUNT];
+
+    portENTER_CRITICAL(&sensor_cache_lock);
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        snapshot[i] = sensor_caches[i];
+    }
+    portEXIT_CRITICAL(&sensor_cache_lock);
+
+    int64_t now_us = esp_timer_get_time();
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_array_begin(&jw, "sensors");
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        json_writer_object_begin(&jw);
+        json_writer_int(&jw, "id", i);
+#if CONFIG_SENSOR_DRIVER_DHT22
+        json_writer_int(&jw, "gpio", sensor_gpios[i]);
+#endif
+        if (snapshot[i].valid) {
+            json_writer_float1(&jw, "temperature", snapshot[i].temperature);
+            json_writer_float1(&jw, "humidity", snapshot[i].humidity);
+            json_writer_uint(&jw, "age",
+                             (uint32_t)((now_us - snapshot[i].timestamp_us) / 1000000));
+            json_writer_string(&jw, "status", "ok");
+        } else {
+            json_writer_string(&jw, "status", "error");
+            json_writer_int(&jw, "code", snapshot[i].status);
+        }
+        json_writer_object_end(&jw);
+    }
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+
+#if CONFIG_ESPNOW_MODE_RELAY
+// Latest reading heard from each leaf node over ESP-NOW
+static esp_err_t remote_get_handler(httpd_req_t *req) {
+    remote_node_t snapshot[REMOTE_MAX_NODES];
+
+    portENTER_CRITICAL(&remote_lock);
+    memcpy(snapshot, remote_nodes, sizeof(snapshot));
+    portEXIT_CRITICAL(&remote_lock);
+
+    int64_t now_us = esp_timer_get_time();
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_array_begin(&jw, "nodes");
+    for (int i = 0; i < REMOTE_MAX_NODES; i++) {
+        if (!snapshot[i].used) {
+            continue;
+        }
+        json_writer_object_begin(&jw);
+        json_writer_uint(&jw, "nodeId", snapshot[i].last.node_id);
+        json_writer_float1(&jw, "temperature", snapshot[i].last.temperature / 100.0f);
+        json_writer_float1(&jw, "humidity", snapshot[i].last.humidity / 100.0f);
+        json_writer_bool(&jw, "relay", snapshot[i].last.relay != 0);
+        json_writer_uint(&jw, "seq", snapshot[i].last.seq);
+        json_writer_uint(&jw, "age",
+                         (uint32_t)((now_us - snapshot[i].rx_time_us) / 1000000));
+        json_writer_object_end(&jw);
+    }
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+#endif // CONFIG_ESPNOW_MODE_RELAY
+
+#if CONFIG_HISTORY_FLASH
+// Streaming adapters for flash_store_read(): flash records share the
+// binary_record_t layout, so the binary path forwards them unmodified.
+typedef struct {
+    httpd_req_t *req;
+    binary_record_t batch[16];
+    size_t batched;
+} flash_binary_ctx_t;
+
+static esp_err_t flash_emit_binary(void *arg, const flash_record_t *rec) {
+    flash_binary_ctx_t *ctx = arg;
+    memcpy(&ctx->batch[ctx->batched++], rec, sizeof(binary_record_t));
+    if (ctx->batched == sizeof(ctx->batch) / sizeof(ctx->batch[0])) {
+        esp_err_t err = httpd_resp_send_chunk(ctx->req, (const char *)ctx->batch,
+                                              ctx->batched * sizeof(binary_record_t));
+        ctx->batched = 0;
+        return err;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t flash_emit_json(void *arg, const flash_record_t *rec) {
+    json_writer_t *jw = arg;
+    json_writer_object_begin(jw);
+    json_writer_uint(jw, "ts", rec->timestamp);
+    json_writer_float1(jw, "temperature", rec->temperature / 100.0f);
+    json_writer_float1(jw, "humidity", rec->humidity / 100.0f);
+    json_writer_object_end(jw);
+    return ESP_OK;
+}
+
+// Serve /api/history from the flash log: same response shapes as the RAM
+// ring, but the data survives reboots and spans the whole partition
+static esp_err_t history_from_flash(httpd_req_t *req, uint32_t since) {
+    if (wants_binary(req)) {
+        httpd_resp_set_type(req, "application/octet-stream");
+
+        flash_binary_ctx_t ctx = { .req = req, .batched = 0 };
+        flash_store_read(since, flash_emit_binary, &ctx);
+        if (ctx.batched > 0) {
+            httpd_resp_send_chunk(req, (const char *)ctx.batch,
+                                  ctx.batched * sizeof(binary_record_t));
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_uint(&jw, "uptime", esp_timer_get_time() / 1000000);
+    json_writer_array_begin(&jw, "records");
+    flash_store_read(since, flash_emit_json, &jw);
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+#endif // CONFIG_HISTORY_FLASH
+
+// Return all buffered readings newer than the "since" cursor (seconds since
+// boot) in one batched response. Records are streamed in chunks so the
+// response size is not bounded by a stack buffer.
+static esp_err_t history_get_handler(httpd_req_t *req) {
+    uint32_t since = 0;
+    char query[32];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+        since = (uint32_t)atoi(value);
+    }
+
+#if CONFIG_HISTORY_FLASH
+    if (flash_store_available()) {
+        return history_from_flash(req, since);
+    }
+#endif
+
+    // Snapshot the ring indices; records are immutable once written, so
+    // only the head/count pair needs the lock.
+    portENTER_CRITICAL(&history_lock);
+    size_t count = history_count;
+    size_t head = history_head;
+    portEXIT_CRITICAL(&history_lock);
+
+    size_t start = (head + CONFIG_HISTORY_BUFFER_SIZE - count) % CONFIG_HISTORY_BUFFER_SIZE;
+
+    // Binary mode: stream packed 8-byte records straight from the ring
+    // buffer, batched into a small stack buffer between chunks
+    if (wants_binary(req)) {
+        httpd_resp_set_type(req, "application/octet-stream");
+
+        binary_record_t batch[16];
+        size_t batched = 0;
+        for (size_t i = 0; i < count; i++) {
+            history_record_t *rec = &history_buffer[(start + i) % CONFIG_HISTORY_BUFFER_SIZE];
+            if (rec->timestamp <= since) {
+                continue;
+            }
+            pack_binary_record(&batch[batched++], rec->timestamp,
+                               rec->temperature, rec->humidity);
+            if (batched == sizeof(batch) / sizeof(batch[0])) {
+                httpd_resp_send_chunk(req, (const char *)batch,
+                                      batched * sizeof(binary_record_t));
+                batched = 0;
+            }
+        }
+        if (batched > 0) {
+            httpd_resp_send_chunk(req, (const char *)batch,
+                                  batched * sizeof(binary_record_t));
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_uint(&jw, "uptime", esp_timer_get_time() / 1000000);
+    json_writer_array_begin(&jw, "records");
+    for (size_t i = 0; i < count; i++) {
+        history_record_t *rec = &history_buffer[(start + i) % CONFIG_HISTORY_BUFFER_SIZE];
+        if (rec->timestamp <= since) {
+            continue;
+        }
+        json_writer_object_begin(&jw);
+        json_writer_uint(&jw, "ts", rec->timestamp);
+        json_writer_float1(&jw, "temperature", rec->temperature);
+        json_writer_float1(&jw, "humidity", rec->humidity);
+        json_writer_object_end(&jw);
+    }
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+
+// SSE subscription: send the stream headers, then park the request as an
+// async handle so the socket stays open after this handler returns. All
+// further writes happen from sse_broadcast().
+static esp_err_t events_get_handler(httpd_req_t *req) {
+    httpd_req_t *async_req;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Async begin failed");
+        return ESP_FAIL;
+    }
+
+    // Headers go out before the slot is published: once the request is
+    // registered, the socket belongs to sse_broadcast() alone, so this
+    // handler must never touch it again (no frame can beat the headers
+    // onto the wire, and no double-complete on a dead socket).
+    const char *headers =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    int fd = httpd_req_to_sockfd(async_req);
+    if (httpd_socket_send(async_req->handle, fd, headers, strlen(headers), 0) < 0) {
+        httpd_req_async_handler_complete(async_req);
+        return ESP_FAIL;
+    }
+
+    int slot = -1;
+    portENTER_CRITICAL(&sse_clients_lock);
+    for (int i = 0; i < MAX_SSE_CLIENTS; i++) {
+        if (sse_clients[i] == NULL) {
+            sse_clients[i] = async_req;
+            slot = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sse_clients_lock);
+
+    if (slot < 0) {
+        // Subscriber limit reached; the stream just closes
+        httpd_req_async_handler_complete(async_req);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "SSE client connected (slot %d)", slot);
+    return ESP_OK;
+}
+
+// Push one event to every subscriber; dead sockets are dropped on the spot.
+static void sse_broadcast(const char *event, const char *json) {
+    char frame[256];
+    int len = snprintf(frame, sizeof(frame), "event: %s\ndata: %s\n\n", event, json);
+    if (len <= 0 || len >= sizeof(frame)) {
+        return;
+    }
+
+    // Drop the event rather than stall the sampling or timer task if a
+    // broadcast to a slow client is already in flight for too long
+    if (sse_send_mutex == NULL ||
+        xSemaphoreTake(sse_send_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_SSE_CLIENTS; i++) {
+        portENTER_CRITICAL(&sse_clients_lock);
+        httpd_req_t *client = sse_clients[i];
+        portEXIT_CRITICAL(&sse_clients_lock);
+        if (client == NULL) {
+            continue;
+        }
+
+        int fd = httpd_req_to_sockfd(client);
+        if (httpd_socket_send(client->handle, fd, frame, len, 0) < 0) {
+            ESP_LOGI(TAG, "SSE client disconnected (slot %d)", i);
+            portENTER_CRITICAL(&sse_clients_lock);
+            sse_clients[i] = NULL;
+            portEXIT_CRITICAL(&sse_clients_lock);
+            httpd_req_async_handler_complete(client);
+        }
+    }
+
+    xSemaphoreGive(sse_send_mutex);
+}
+
+// Stream a firmware image into the inactive OTA partition and reboot into
+// it. With BOOTLOADER_APP_ROLLBACK_ENABLE the new image must mark itself
+// valid after boot (see app_main); otherwise the bootloader falls back to
+// the previous partition on the next reset.
+static esp_err_t ota_post_handler(httpd_req_t *req) {
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No OTA partition");
+        return ESP_FAIL;
+    }
+
+    if (req->content_len == 0 || req->content_len > update_partition->size) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad image size");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "OTA: writing %u bytes to %s",
+             (unsigned)req->content_len, update_partition->label);
+
+    esp_ota_handle_t ota_handle;
+    esp_err_t err = esp_ota_begin(update_partition, req->content_len, &ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA begin failed");
+        return ESP_FAIL;
+    }
+
+    char buf[1024];
+    size_t remaining = req->content_len;
+    int timeouts = 0;
+    while (remaining > 0) {
+        int received = httpd_req_recv(req, buf,
+            remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (received <= 0) {
+            // A few receive timeouts in a row mean the client stalled;
+            // give up rather than pin this worker (and the OTA handle)
+            // on an upload that is never going to finish
+            if (received == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < 3) {
+                continue;
+            }
+            ESP_LOGW(TAG, "OTA upload aborted with %u bytes left",
+                     (unsigned)remaining);
+            esp_ota_abort(ota_handle);
+            return ESP_FAIL;
+        }
+        timeouts = 0;
+        err = esp_ota_write(ota_handle, buf, received);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
+            esp_ota_abort(ota_handle);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA write failed");
+            return ESP_FAIL;
+        }
+        remaining -= received;
+    }
+
+    // Validates the image (magic, checksum, secure-boot digest if enabled)
+    err = esp_ota_end(ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Image validation failed");
+        return ESP_FAIL;
+    }
+
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Set boot failed");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "{\"status\":\"ok\",\"message\":\"Rebooting into new firmware\"}");
+
+    // Delay restart to allow response to be sent
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
     return ESP_OK;
 }
 
@@ -580,17 +1934,26 @@ static esp_err_t relay_post_handler(httpd_req_t *req) {
     buf[ret] = '\0';
     
     // Parse and set relay state
-    if (strstr(buf, "\"state\":\"on\"")) {
-        state = 1;  // Set to ON
-        success = true;
-    } else if (strstr(buf, "\"state\":\"off\"")) {
-        state = 0;  // Set to OFF
-        success = true;
-    }
+    state = parse_relay_state(buf);
+    success = (state >= 0);
 
     if (success) {
+        portENTER_CRITICAL(&relay_state_lock);
         relay_timer.enabled = false;  // Disable timer when manually setting state
+        bool release_hold = humidity_ctl.active;
+        humidity_ctl.active = false;  // Manual override releases a humidity hold
+        portEXIT_CRITICAL(&relay_state_lock);
+
+        relay_schedule_next();        // Disarm the pending toggle
+        if (release_hold) {
+            esp_timer_stop(humidity_off_timer);
+        }
         gpio_set_level(RELAY_GPIO, state);  // Set the actual GPIO level
+
+        create_json_response(response, sizeof(response),
+            "{\"state\":\"%s\"}", state ? "on" : "off");
+        sse_broadcast("relay", response);
+        mdns_update_telemetry();
     }
 
     // Set response headers
@@ -613,16 +1976,19 @@ static esp_err_t relay_post_handler(httpd_req_t *req) {
 
 static esp_err_t timer_handler(httpd_req_t *req) {
     if (req->method == HTTP_GET) {
-        char response[200];
-        create_json_response(response, sizeof(response),
-            "{\"enabled\":%s,\"onDuration\":%u,\"offDuration\":%u,\"currentState\":%s}",
-            relay_timer.enabled ? "true" : "false",
-            relay_timer.on_duration / 1000,
-            relay_timer.off_duration / 1000,
-            relay_timer.current_state ? "true" : "false");
-        
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, response);
+        portENTER_CRITICAL(&relay_state_lock);
+        timer_config_t snapshot = relay_timer;
+        portEXIT_CRITICAL(&relay_state_lock);
+
+        json_writer_t jw;
+        json_response_begin(&jw, req);
+        json_writer_object_begin(&jw);
+        json_writer_bool(&jw, "enabled", snapshot.enabled);
+        json_writer_uint(&jw, "onDuration", snapshot.on_duration / 1000);
+        json_writer_uint(&jw, "offDuration", snapshot.off_duration / 1000);
+        json_writer_bool(&jw, "currentState", snapshot.current_state);
+        json_writer_object_end(&jw);
+        return json_response_end(&jw, req);
     } else if (req->method == HTTP_POST) {
         char buf[100];
         int ret = httpd_req_recv(req, buf, sizeof(buf));
@@ -631,49 +1997,282 @@ static esp_err_t timer_handler(httpd_req_t *req) {
         buf[ret] = '\0';
         
         // Simple string parsing
-        if (strstr(buf, "\"enabled\":true")) {
+        timer_request_t parsed;
+        parse_timer_request(buf, &parsed);
+
+        // Apply the whole update in one critical section so the control
+        // path never sees a half-written enabled/duration combination
+        portENTER_CRITICAL(&relay_state_lock);
+        if (parsed.enabled == 1) {
             relay_timer.enabled = true;
-        } else if (strstr(buf, "\"enabled\":false")) {
+        } else if (parsed.enabled == 0) {
             relay_timer.enabled = false;
-            gpio_set_level(RELAY_GPIO, 0);
             relay_timer.current_state = false;
         }
-        
-        char *on_dur = strstr(buf, "\"onDuration\":");
-        if (on_dur) {
-            relay_timer.on_duration = atoi(on_dur + 13) * 1000;
+        // The timer takes the relay over; release any humidity hold so
+        // humidity_off_callback can't fire against timer state
+        bool release_hold = relay_timer.enabled && humidity_ctl.active;
+        if (release_hold) {
+            humidity_ctl.active = false;
+            humidity_ctl.cooldown_until_us = esp_timer_get_time() +
+                (int64_t)humidity_ctl.cooldown_s * 1000000;
         }
-        
-        char *off_dur = strstr(buf, "\"offDuration\":");
-        if (off_dur) {
-            relay_timer.off_duration = atoi(off_dur + 14) * 1000;
+        if (parsed.on_duration_s >= 0) {
+            relay_timer.on_duration = parsed.on_duration_s * 1000;
+        }
+        if (parsed.off_duration_s >= 0) {
+            relay_timer.off_duration = parsed.off_duration_s * 1000;
         }
-
         relay_timer.last_toggle = esp_timer_get_time() / 1000;
+        timer_config_t snapshot = relay_timer;
+        portEXIT_CRITICAL(&relay_state_lock);
+
+        if (parsed.enabled == 0) {
+            gpio_set_level(RELAY_GPIO, 0);
+        }
+        if (release_hold) {
+            esp_timer_stop(humidity_off_timer);
+            gpio_set_level(RELAY_GPIO, snapshot.current_state ? 1 : 0);
+        }
+        relay_schedule_next();
+
+        // Persist as the boot defaults
+        config_timer_defaults_t defaults = {
+            .enabled = snapshot.enabled,
+            .on_duration_ms = snapshot.on_duration,
+            .off_duration_ms = snapshot.off_duration,
+        };
+        config_store_set_timer(&defaults);
+
+        char json[128];
+        create_json_response(json, sizeof(json),
+            "{\"enabled\":%s,\"onDuration\":%u,\"offDuration\":%u}",
+            snapshot.enabled ? "true" : "false",
+            snapshot.on_duration / 1000,
+            snapshot.off_duration / 1000);
+        sse_broadcast("timer", json);
+
         httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
     }
     return ESP_OK;
 }
 
-// Add hostname handlers
-static esp_err_t hostname_get_handler(httpd_req_t *req) {
-    nvs_handle_t nvs_handle;
-    char hostname[32] = DEFAULT_HOSTNAME;
-    size_t hostname_len = sizeof(hostname);
+// End of the on-time: release the relay and start the cooldown window.
+// Runs in the esp_timer service task, same context as relay_toggle_callback.
+static void humidity_off_callback(void *arg) {
+    portENTER_CRITICAL(&relay_state_lock);
+    if (!humidity_ctl.active) {
+        portEXIT_CRITICAL(&relay_state_lock);
+        return;
+    }
+    humidity_ctl.active = false;
+    humidity_ctl.cooldown_until_us = esp_timer_get_time() +
+        (int64_t)humidity_ctl.cooldown_s * 1000000;
+    portEXIT_CRITICAL(&relay_state_lock);
+    gpio_set_level(RELAY_GPIO, 0);
+
+    sse_broadcast("relay", "{\"state\":\"off\"}");
+    mdns_update_telemetry();
+    ESP_LOGI(TAG, "Humidity hold finished, cooldown %us", (unsigned)humidity_ctl.cooldown_s);
+}
 
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err == ESP_OK) {
-        nvs_get_str(nvs_handle, NVS_KEY_HOSTNAME, hostname, &hostname_len);
-        nvs_close(nvs_handle);
+// Called from the sampling task with every fresh primary-sensor sample.
+// Actuation latency is therefore one sampling period, and the loop keeps
+// running with WiFi and the collector both down.
+static void humidity_control_evaluate(float humidity) {
+    portENTER_CRITICAL(&relay_state_lock);
+    humidity_ctl_t snapshot = humidity_ctl;
+    bool trigger = snapshot.enabled && !snapshot.active &&
+                   !relay_timer.enabled &&
+                   esp_timer_get_time() >= snapshot.cooldown_until_us &&
+                   humidity < snapshot.threshold && snapshot.on_time_s > 0;
+    if (trigger) {
+        humidity_ctl.active = true;
     }
+    portEXIT_CRITICAL(&relay_state_lock);
 
-    char response[64];
-    create_json_response(response, sizeof(response), 
-        "{\"hostname\":\"%s\"}", hostname);
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, response);
-    return ESP_OK;
+    if (!trigger) {
+        return;
+    }
+
+    gpio_set_level(RELAY_GPIO, 1);
+    esp_timer_start_once(humidity_off_timer,
+                         (uint64_t)snapshot.on_time_s * 1000000);
+
+    sse_broadcast("relay", "{\"state\":\"on\"}");
+    mdns_update_telemetry();
+    ESP_LOGI(TAG, "Humidity %.1f%% below threshold %.1f%%, relay on for %us",
+             humidity, snapshot.threshold, (unsigned)snapshot.on_time_s);
+}
+
+static esp_err_t humidity_handler(httpd_req_t *req) {
+    if (req->method == HTTP_POST) {
+        char buf[128];
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        if (ret <= 0) return ESP_FAIL;
+        buf[ret] = '\0';
+
+        humidity_ctl_request_t parsed;
+        parse_humidity_ctl_request(buf, &parsed);
+
+        portENTER_CRITICAL(&relay_state_lock);
+        if (parsed.enabled == 1) {
+            humidity_ctl.enabled = true;
+        } else if (parsed.enabled == 0) {
+            humidity_ctl.enabled = false;
+        }
+        bool release_hold = !humidity_ctl.enabled && humidity_ctl.active;
+        if (release_hold) {
+            humidity_ctl.active = false;
+        }
+        if (parsed.threshold >= 0) {
+            humidity_ctl.threshold = (float)parsed.threshold;
+        }
+        if (parsed.on_time_s >= 0) {
+            humidity_ctl.on_time_s = parsed.on_time_s;
+        }
+        if (parsed.cooldown_s >= 0) {
+            humidity_ctl.cooldown_s = parsed.cooldown_s;
+        }
+        humidity_ctl_t updated = humidity_ctl;
+        portEXIT_CRITICAL(&relay_state_lock);
+
+        if (release_hold) {
+            esp_timer_stop(humidity_off_timer);
+            gpio_set_level(RELAY_GPIO, 0);
+        }
+
+        config_humidity_ctl_t cfg = {
+            .enabled = updated.enabled,
+            .threshold = updated.threshold,
+            .on_time_s = updated.on_time_s,
+            .cooldown_s = updated.cooldown_s,
+        };
+        config_store_set_humidity_ctl(&cfg);
+    }
+
+    portENTER_CRITICAL(&relay_state_lock);
+    humidity_ctl_t snapshot = humidity_ctl;
+    portEXIT_CRITICAL(&relay_state_lock);
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_bool(&jw, "enabled", snapshot.enabled);
+    json_writer_float1(&jw, "threshold", snapshot.threshold);
+    json_writer_uint(&jw, "onTime", snapshot.on_time_s);
+    json_writer_uint(&jw, "cooldown", snapshot.cooldown_s);
+    json_writer_bool(&jw, "active", snapshot.active);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+
+// Minutes since local midnight, or -1 until SNTP has set the clock
+static int wall_clock_minute(void) {
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    if (tm_now.tm_year + 1900 < 2020) {
+        return -1;
+    }
+    return tm_now.tm_hour * 60 + tm_now.tm_min;
+}
+
+// Periodic schedule tick. The humidity hold and manual overrides act on
+// the relay directly; the schedule only writes the GPIO on a state
+// transition, so a manual state sticks until the next scheduled edge.
+static void schedule_eval_callback(void *arg) {
+    portENTER_CRITICAL(&relay_state_lock);
+    bool hold_active = humidity_ctl.active;
+    schedule_t sched = relay_schedule;
+    portEXIT_CRITICAL(&relay_state_lock);
+
+    if (sched.count == 0 || hold_active) {
+        return;
+    }
+
+    bool desired = schedule_evaluate(&sched, wall_clock_minute(),
+                                     (uint32_t)(esp_timer_get_time() / 1000000));
+
+    // Claim the transition under the lock: when the POST handler's
+    // immediate evaluation overlaps a periodic tick, only one of them
+    // acts on the edge
+    portENTER_CRITICAL(&relay_state_lock);
+    bool changed = (desired != schedule_last_state);
+    if (changed) {
+        schedule_last_state = desired;
+    }
+    portEXIT_CRITICAL(&relay_state_lock);
+    if (!changed) {
+        return;
+    }
+    gpio_set_level(RELAY_GPIO, desired ? 1 : 0);
+
+    sse_broadcast("relay", desired ? "{\"state\":\"on\"}" : "{\"state\":\"off\"}");
+    mdns_update_telemetry();
+    ESP_LOGI(TAG, "Schedule: relay %s", desired ? "on" : "off");
+}
+
+static esp_err_t schedule_handler(httpd_req_t *req) {
+    if (req->method == HTTP_POST) {
+        char buf[512];
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        if (ret <= 0) return ESP_FAIL;
+        buf[ret] = '\0';
+
+        schedule_t parsed;
+        if (!schedule_parse(buf, &parsed)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid schedule");
+            return ESP_FAIL;
+        }
+
+        portENTER_CRITICAL(&relay_state_lock);
+        relay_schedule = parsed;
+        portEXIT_CRITICAL(&relay_state_lock);
+        config_store_set_schedule(&parsed);
+        schedule_eval_callback(NULL);   // apply the new schedule immediately
+    }
+
+    portENTER_CRITICAL(&relay_state_lock);
+    schedule_t snapshot = relay_schedule;
+    portEXIT_CRITICAL(&relay_state_lock);
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_bool(&jw, "clockSynced", wall_clock_minute() >= 0);
+    json_writer_array_begin(&jw, "entries");
+    for (int i = 0; i < snapshot.count; i++) {
+        const schedule_entry_t *entry = &snapshot.entries[i];
+        json_writer_object_begin(&jw);
+        json_writer_string(&jw, "type",
+            entry->type == SCHEDULE_ENTRY_WINDOW ? "window" : "interval");
+        json_writer_bool(&jw, "enabled", entry->enabled);
+        if (entry->type == SCHEDULE_ENTRY_WINDOW) {
+            json_writer_uint(&jw, "start", entry->start_min);
+            json_writer_uint(&jw, "end", entry->end_min);
+        } else {
+            json_writer_uint(&jw, "period", entry->period_s);
+            json_writer_uint(&jw, "duration", entry->duration_s);
+        }
+        json_writer_object_end(&jw);
+    }
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
+}
+
+// Add hostname handlers
+static esp_err_t hostname_get_handler(httpd_req_t *req) {
+    char hostname[32];
+    config_store_get_hostname(hostname, sizeof(hostname));
+
+    json_writer_t jw;
+    json_response_begin(&jw, req);
+    json_writer_object_begin(&jw);
+    json_writer_string(&jw, "hostname", hostname);
+    json_writer_object_end(&jw);
+    return json_response_end(&jw, req);
 }
 
 static esp_err_t hostname_post_handler(httpd_req_t *req) {
@@ -682,33 +2281,21 @@ static esp_err_t hostname_post_handler(httpd_req_t *req) {
     if (ret <= 0) return ESP_FAIL;
     
     buf[ret] = '\0';
-    
+
     // Parse hostname from JSON
-    char *hostname_start = strstr(buf, "\"hostname\":\"");
-    if (hostname_start) {
-        hostname_start += 11;
-        char *hostname_end = strchr(hostname_start, '"');
-        if (hostname_end) {
-            *hostname_end = '\0';
-            
-            // Store hostname in NVS
-            nvs_handle_t nvs_handle;
-            esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-            if (err == ESP_OK) {
-                nvs_set_str(nvs_handle, NVS_KEY_HOSTNAME, hostname_start);
-                nvs_commit(nvs_handle);
-                nvs_close(nvs_handle);
-                
-                // Update network hostname
-                esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-                if (netif) {
-                    esp_netif_set_hostname(netif, hostname_start);
-                }
-                
-                // Update mDNS hostname
-                mdns_hostname_set(hostname_start);
-                mdns_instance_name_set(hostname_start);
+    char hostname[32];
+    if (parse_hostname(buf, hostname, sizeof(hostname))) {
+        // Cache + write-through to NVS
+        if (config_store_set_hostname(hostname) == ESP_OK) {
+            // Update network hostname
+            esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+            if (netif) {
+                esp_netif_set_hostname(netif, hostname);
             }
+
+            // Update mDNS hostname
+            mdns_hostname_set(hostname);
+            mdns_instance_name_set(hostname);
         }
     }
 
@@ -716,23 +2303,54 @@ static esp_err_t hostname_post_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
-// Timer control task
-static void timer_control_task(void *pvParameters) {
-    while (1) {
-        if (relay_timer.enabled) {
-            uint32_t current_time = esp_timer_get_time() / 1000;
-            uint32_t elapsed = current_time - relay_timer.last_toggle;
-            
-            if (relay_timer.current_state && elapsed >= relay_timer.on_duration) {
-                gpio_set_level(RELAY_GPIO, 0);
-                relay_timer.current_state = false;
-                relay_timer.last_toggle = current_time;
-            } else if (!relay_timer.current_state && elapsed >= relay_timer.off_duration) {
-                gpio_set_level(RELAY_GPIO, 1);
-                relay_timer.current_state = true;
-                relay_timer.last_toggle = current_time;
-            }
+// Toggle callback, runs in the esp_timer task at the scheduled instant
+static void relay_toggle_callback(void *arg) {
+    bool new_state;
+
+    portENTER_CRITICAL(&relay_state_lock);
+    if (!relay_timer.enabled) {
+        portEXIT_CRITICAL(&relay_state_lock);
+        return;
+    }
+    relay_timer.current_state = !relay_timer.current_state;
+    relay_timer.last_toggle = esp_timer_get_time() / 1000;
+    new_state = relay_timer.current_state;
+    portEXIT_CRITICAL(&relay_state_lock);
+
+    gpio_set_level(RELAY_GPIO, new_state ? 1 : 0);
+    relay_schedule_next();
+    mdns_update_telemetry();
+}
+
+// (Re)arm the one-shot timer for the next toggle, or disarm it when the
+// schedule is disabled. Called after every toggle and every config change.
+// Works on a snapshot; arming the esp_timer must not happen under the
+// spinlock. The stop/start pair runs under a mutex: an httpd POST
+// overlapping a toggle callback would otherwise interleave the pairs
+// and make the second start_once fail on an already-armed timer.
+static void relay_schedule_next(void) {
+    xSemaphoreTake(relay_rearm_mutex, portMAX_DELAY);
+
+    portENTER_CRITICAL(&relay_state_lock);
+    timer_config_t snapshot = relay_timer;
+    portEXIT_CRITICAL(&relay_state_lock);
+
+    esp_timer_stop(relay_toggle_timer);   // no-op if not armed
+
+    uint32_t next_ms = 0;
+    if (snapshot.enabled) {
+        next_ms = snapshot.current_state ? snapshot.on_duration
+                                         : snapshot.off_duration;
+    }
+    if (next_ms > 0) {
+        // Not asserted: a lost rearm just means the next config change
+        // or toggle re-evaluates, which beats rebooting the node
+        esp_err_t err = esp_timer_start_once(relay_toggle_timer,
+                                             (uint64_t)next_ms * 1000);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Relay rearm failed: %s", esp_err_to_name(err));
         }
-        vTaskDelay(pdMS_TO_TICKS(100)); // Check every 100ms
     }
+
+    xSemaphoreGive(relay_rearm_mutex);
 }
@@ -0,0 +1,175 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "metrics.h"
+
+// Histogram buckets in microseconds; the last implicit bucket is +Inf
+static const uint32_t bucket_bounds_us[] =
+    {1000, 5000, 10000, 50000, 100000, 500000, 1000000};
+#define NUM_BUCKETS (sizeof(bucket_bounds_us) / sizeof(bucket_bounds_us[0]))
+
+static const char *counter_names[METRIC_COUNTER_MAX] = {
+    "labnode_dht_read_attempts_total",
+    "labnode_dht_read_timeouts_total",
+    "labnode_dht_crc_failures_total",
+};
+
+static const char *uri_labels[METRIC_URI_MAX] = {
+    "sensor", "history", "relay", "timer", "hostname", "scan", "humidity", "schedule", "remote",
+};
+
+static atomic_uint_fast32_t counters[METRIC_COUNTER_MAX];
+
+typedef struct {
+    atomic_uint_fast32_t buckets[NUM_BUCKETS + 1];  // +1 for +Inf
+    atomic_uint_fast32_t count;
+    atomic_uint_fast64_t sum_us;
+} latency_histogram_t;
+
+static latency_histogram_t latency[METRIC_URI_MAX];
+
+static TaskHandle_t watched_task = NULL;
+
+// Boot-stage timeline: microseconds since reset at which each stage
+// finished. Names are expected to be string literals.
+#define MAX_BOOT_STAGES 8
+typedef struct {
+    const char *name;
+    int64_t us;
+} boot_stage_t;
+
+static boot_stage_t boot_stages[MAX_BOOT_STAGES];
+static int boot_stage_count = 0;
+
+void metrics_counter_inc(metric_counter_t counter) {
+    atomic_fetch_add(&counters[counter], 1);
+}
+
+void metrics_record_latency(metric_uri_t uri, int64_t start_us) {
+    uint64_t elapsed = esp_timer_get_time() - start_us;
+    latency_histogram_t *hist = &latency[uri];
+
+    size_t bucket = NUM_BUCKETS;    // +Inf
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        if (elapsed <= bucket_bounds_us[i]) {
+            bucket = i;
+            break;
+        }
+    }
+    atomic_fetch_add(&hist->buckets[bucket], 1);
+    atomic_fetch_add(&hist->count, 1);
+    atomic_fetch_add(&hist->sum_us, elapsed);
+}
+
+void metrics_boot_stage(const char *name) {
+    if (boot_stage_count < MAX_BOOT_STAGES) {
+        boot_stages[boot_stage_count].name = name;
+        boot_stages[boot_stage_count].us = esp_timer_get_time();
+        boot_stage_count++;
+    }
+}
+
+void metrics_watch_task(TaskHandle_t task) {
+    watched_task = task;
+}
+
+// Accumulate lines into a scratch buffer, flushing a chunk when full
+typedef struct {
+    httpd_req_t *req;
+    char buf[512];
+    size_t len;
+} metrics_out_t;
+
+static void out_flush(metrics_out_t *out) {
+    if (out->len > 0) {
+        httpd_resp_send_chunk(out->req, out->buf, out->len);
+        out->len = 0;
+    }
+}
+
+static void out_printf(metrics_out_t *out, const char *format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+    if (out->len + len > sizeof(out->buf)) {
+        out_flush(out);
+    }
+    memcpy(out->buf + out->len, line, len);
+    out->len += len;
+}
+
+esp_err_t metrics_get_handler(httpd_req_t *req) {
+    metrics_out_t out = { .req = req, .len = 0 };
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+    for (int i = 0; i < METRIC_COUNTER_MAX; i++) {
+        out_printf(&out, "# TYPE %s counter\n%s %lu\n",
+                   counter_names[i], counter_names[i],
+                   (unsigned long)atomic_load(&counters[i]));
+    }
+
+    out_printf(&out, "# TYPE labnode_request_duration_us histogram\n");
+    for (int u = 0; u < METRIC_URI_MAX; u++) {
+        latency_histogram_t *hist = &latency[u];
+        unsigned long cumulative = 0;
+        for (size_t b = 0; b < NUM_BUCKETS; b++) {
+            cumulative += atomic_load(&hist->buckets[b]);
+            out_printf(&out,
+                "labnode_request_duration_us_bucket{uri=\"%s\",le=\"%lu\"} %lu\n",
+                uri_labels[u], (unsigned long)bucket_bounds_us[b], cumulative);
+        }
+        cumulative += atomic_load(&hist->buckets[NUM_BUCKETS]);
+        out_printf(&out,
+            "labnode_request_duration_us_bucket{uri=\"%s\",le=\"+Inf\"} %lu\n",
+            uri_labels[u], cumulative);
+        out_printf(&out, "labnode_request_duration_us_sum{uri=\"%s\"} %llu\n",
+                   uri_labels[u],
+                   (unsigned long long)atomic_load(&hist->sum_us));
+        out_printf(&out, "labnode_request_duration_us_count{uri=\"%s\"} %lu\n",
+                   uri_labels[u], (unsigned long)atomic_load(&hist->count));
+    }
+
+    out_printf(&out, "# TYPE labnode_heap_free_bytes gauge\n"
+                     "labnode_heap_free_bytes %lu\n",
+               (unsigned long)esp_get_free_heap_size());
+    out_printf(&out, "# TYPE labnode_heap_min_free_bytes gauge\n"
+                     "labnode_heap_min_free_bytes %lu\n",
+               (unsigned long)esp_get_minimum_free_heap_size());
+    out_printf(&out, "# TYPE labnode_uptime_seconds counter\n"
+                     "labnode_uptime_seconds %lu\n",
+               (unsigned long)(esp_timer_get_time() / 1000000));
+
+    if (watched_task != NULL) {
+        out_printf(&out, "# TYPE labnode_sampling_task_stack_free_bytes gauge\n"
+                         "labnode_sampling_task_stack_free_bytes %lu\n",
+                   (unsigned long)(uxTaskGetStackHighWaterMark(watched_task) *
+                                   sizeof(StackType_t)));
+    }
+
+    if (boot_stage_count > 0) {
+        out_printf(&out, "# TYPE labnode_boot_stage_us gauge\n");
+        for (int i = 0; i < boot_stage_count; i++) {
+            out_printf(&out, "labnode_boot_stage_us{stage=\"%s\"} %lld\n",
+                       boot_stages[i].name, (long long)boot_stages[i].us);
+        }
+    }
+
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        out_printf(&out, "# TYPE labnode_wifi_rssi_dbm gauge\n"
+                         "labnode_wifi_rssi_dbm %d\n", ap_info.rssi);
+    }
+
+    out_flush(&out);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
@@ -0,0 +1,52 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Hot-path instrumentation: plain atomic counters and fixed-bucket latency
+// histograms, cheap enough to live permanently on the request and sensor
+// paths. Exposed at GET /api/metrics in Prometheus text format.
+
+typedef enum {
+    METRIC_DHT_READ_ATTEMPTS,
+    METRIC_DHT_READ_TIMEOUTS,
+    METRIC_DHT_CRC_FAILURES,
+    METRIC_COUNTER_MAX
+} metric_counter_t;
+
+typedef enum {
+    METRIC_URI_SENSOR,
+    METRIC_URI_HISTORY,
+    METRIC_URI_RELAY,
+    METRIC_URI_TIMER,
+    METRIC_URI_HOSTNAME,
+    METRIC_URI_SCAN,
+    METRIC_URI_HUMIDITY,
+    METRIC_URI_SCHEDULE,
+    METRIC_URI_REMOTE,
+    METRIC_URI_MAX
+} metric_uri_t;
+
+// Single atomic increment
+void metrics_counter_inc(metric_counter_t counter);
+
+// Record a boot stage completion at the current esp_timer time. Called
+// from app_main and the WiFi bring-up path; the stages appear as
+// labnode_boot_stage_us{stage="..."} gauges.
+void metrics_boot_stage(const char *name);
+
+// Record a request latency sample; start_us is the esp_timer time taken
+// at the top of the handler
+void metrics_record_latency(metric_uri_t uri, int64_t start_us);
+
+// GET /api/metrics handler (Prometheus text exposition format)
+esp_err_t metrics_get_handler(httpd_req_t *req);
+
+// Optional: task whose stack high-water mark is reported (sampling task)
+void metrics_watch_task(TaskHandle_t task);
+
+#endif // METRICS_H
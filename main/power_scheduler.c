@@ -0,0 +1,151 @@
+#include "sdkconfig.h"
+
+// Compiled unconditionally; the body only exists for battery builds. The
+// CONFIG_BATTERY_* symbols depend on BATTERY_MODE (default n), so
+// guarding here keeps mains-powered builds compiling.
+#if CONFIG_BATTERY_MODE
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_wifi.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "power_scheduler.h"
+#include "config_store.h"
+
+#define TAG "power_sched"
+
+#define FLUSH_CONNECT_TIMEOUT_MS 15000
+
+// Packed reading kept in RTC slow memory across sleep. Same layout as the
+// binary wire format in main.c, so the collector reuses its decoder.
+typedef struct __attribute__((packed)) {
+    int16_t temperature;    // centi-degrees C
+    int16_t humidity;       // centi-percent RH
+    uint32_t timestamp;     // seconds since boot
+} rtc_sample_t;
+
+#define RTC_SAMPLE_CAPACITY 120
+
+RTC_DATA_ATTR static rtc_sample_t rtc_samples[RTC_SAMPLE_CAPACITY];
+RTC_DATA_ATTR static uint32_t rtc_sample_count = 0;
+
+static EventGroupHandle_t flush_event_group;
+#define FLUSH_GOT_IP_BIT BIT0
+
+static void flush_wifi_event_handler(void *arg, esp_event_base_t event_base,
+                                     int32_t event_id, void *event_data) {
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        xEventGroupSetBits(flush_event_group, FLUSH_GOT_IP_BIT);
+    }
+}
+
+static void buffer_sample(float temperature, float humidity) {
+    if (rtc_sample_count >= RTC_SAMPLE_CAPACITY) {
+        // Buffer full: drop the oldest sample rather than the newest
+        memmove(&rtc_samples[0], &rtc_samples[1],
+                (RTC_SAMPLE_CAPACITY - 1) * sizeof(rtc_sample_t));
+        rtc_sample_count = RTC_SAMPLE_CAPACITY - 1;
+    }
+    rtc_samples[rtc_sample_count].temperature = (int16_t)(temperature * 100);
+    rtc_samples[rtc_sample_count].humidity = (int16_t)(humidity * 100);
+    rtc_samples[rtc_sample_count].timestamp = esp_timer_get_time() / 1000000;
+    rtc_sample_count++;
+}
+
+// Bring WiFi up, POST the buffered records to the collector, tear WiFi
+// down again. The buffer is only cleared once the POST succeeds.
+static void flush_buffer(void) {
+    char ssid[CONFIG_STORE_SSID_LEN];
+    char pass[CONFIG_STORE_PASS_LEN];
+    if (!config_store_get_wifi(ssid, sizeof(ssid), pass, sizeof(pass))) {
+        ESP_LOGW(TAG, "No WiFi credentials, keeping %u buffered samples",
+                 (unsigned)rtc_sample_count);
+        return;
+    }
+
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+        },
+    };
+    strcpy((char *)wifi_config.sta.ssid, ssid);
+    strcpy((char *)wifi_config.sta.password, pass);
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    EventBits_t bits = xEventGroupWaitBits(flush_event_group, FLUSH_GOT_IP_BIT,
+                                           pdTRUE, pdFALSE,
+                                           pdMS_TO_TICKS(FLUSH_CONNECT_TIMEOUT_MS));
+    if (bits & FLUSH_GOT_IP_BIT) {
+        esp_http_client_config_t http_config = {
+            .url = CONFIG_BATTERY_COLLECTOR_URL,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = 10000,
+        };
+        esp_http_client_handle_t client = esp_http_client_init(&http_config);
+        esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
+        esp_http_client_set_post_field(client, (const char *)rtc_samples,
+                                       rtc_sample_count * sizeof(rtc_sample_t));
+
+        esp_err_t err = esp_http_client_perform(client);
+        int status = esp_http_client_get_status_code(client);
+        if (err == ESP_OK && status >= 200 && status < 300) {
+            ESP_LOGI(TAG, "Flushed %u samples", (unsigned)rtc_sample_count);
+            rtc_sample_count = 0;
+        } else {
+            ESP_LOGW(TAG, "Flush failed (%s, status %d), keeping buffer",
+                     esp_err_to_name(err), status);
+        }
+        esp_http_client_cleanup(client);
+    } else {
+        ESP_LOGW(TAG, "WiFi connect timed out, keeping buffer");
+    }
+
+    esp_wifi_stop();
+}
+
+void power_scheduler_run(power_sample_fn_t sample_fn) {
+    flush_event_group = xEventGroupCreate();
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
+                                               &flush_wifi_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                                               &flush_wifi_event_handler, NULL));
+
+    const uint32_t samples_per_flush =
+        (CONFIG_BATTERY_FLUSH_PERIOD_MIN * 60) / CONFIG_SENSOR_SAMPLE_PERIOD_S;
+
+    ESP_LOGI(TAG, "Battery mode: sample every %d s, flush every %d min "
+                  "(%u buffered samples carried over)",
+             CONFIG_SENSOR_SAMPLE_PERIOD_S, CONFIG_BATTERY_FLUSH_PERIOD_MIN,
+             (unsigned)rtc_sample_count);
+
+    uint32_t samples_since_flush = 0;
+    while (1) {
+        float temperature = 0, humidity = 0;
+        if (sample_fn(&temperature, &humidity) == ESP_OK) {
+            buffer_sample(temperature, humidity);
+        }
+        samples_since_flush++;
+
+        if (samples_since_flush >= samples_per_flush && rtc_sample_count > 0) {
+            flush_buffer();
+            samples_since_flush = 0;
+        }
+
+        // Light sleep until the next sample is due; RTC memory, and with it
+        // the sample buffer, is retained
+        esp_sleep_enable_timer_wakeup((uint64_t)CONFIG_SENSOR_SAMPLE_PERIOD_S * 1000000);
+        esp_light_sleep_start();
+    }
+}
+
+#endif // CONFIG_BATTERY_MODE
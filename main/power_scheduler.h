@@ -0,0 +1,21 @@
+#ifndef POWER_SCHEDULER_H
+#define POWER_SCHEDULER_H
+
+#include "esp_err.h"
+
+// Duty-cycled operation for battery-powered nodes (CONFIG_BATTERY_MODE).
+// The node samples the sensor on a period, buffers readings in RTC slow
+// memory (which survives light and deep sleep), and only brings WiFi up
+// every CONFIG_BATTERY_FLUSH_PERIOD_MIN minutes to POST the buffered
+// records to the collector before sleeping again. No sample is lost
+// between flushes.
+
+// Sensor read callback, e.g. read_sensor_safe from main.c
+typedef esp_err_t (*power_sample_fn_t)(float *temperature, float *humidity);
+
+// Run the sample/sleep/flush loop; does not return. WiFi and the HTTP
+// server must NOT be running — the scheduler brings WiFi up and down
+// itself around each flush.
+void power_scheduler_run(power_sample_fn_t sample_fn) __attribute__((noreturn));
+
+#endif // POWER_SCHEDULER_H
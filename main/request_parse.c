@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+#include "request_parse.h"
+
+int parse_relay_state(const char *body) {
+    if (strstr(body, "\"state\":\"on\"")) {
+        return 1;
+    }
+    if (strstr(body, "\"state\":\"off\"")) {
+        return 0;
+    }
+    return -1;
+}
+
+void parse_timer_request(const char *body, timer_request_t *out) {
+    out->enabled = -1;
+    out->on_duration_s = -1;
+    out->off_duration_s = -1;
+
+    if (strstr(body, "\"enabled\":true")) {
+        out->enabled = 1;
+    } else if (strstr(body, "\"enabled\":false")) {
+        out->enabled = 0;
+    }
+
+    const char *on_dur = strstr(body, "\"onDuration\":");
+    if (on_dur) {
+        out->on_duration_s = atol(on_dur + 13);
+    }
+
+    const char *off_dur = strstr(body, "\"offDuration\":");
+    if (off_dur) {
+        out->off_duration_s = atol(off_dur + 14);
+    }
+}
+
+void parse_humidity_ctl_request(const char *body, humidity_ctl_request_t *out) {
+    out->enabled = -1;
+    out->threshold = -1;
+    out->on_time_s = -1;
+    out->cooldown_s = -1;
+
+    if (strstr(body, "\"enabled\":true")) {
+        out->enabled = 1;
+    } else if (strstr(body, "\"enabled\":false")) {
+        out->enabled = 0;
+    }
+
+    const char *threshold = strstr(body, "\"threshold\":");
+    if (threshold) {
+        out->threshold = atof(threshold + 12);
+    }
+
+    const char *on_time = strstr(body, "\"onTime\":");
+    if (on_time) {
+        out->on_time_s = atol(on_time + 9);
+    }
+
+    const char *cooldown = strstr(body, "\"cooldown\":");
+    if (cooldown) {
+        out->cooldown_s = atol(cooldown + 11);
+    }
+}
+
+// Copy a quoted value following `anchor` (e.g. "\"ssid\":\"") into buf
+static bool copy_quoted_value(const char *body, const char *anchor,
+                              char *buf, size_t len) {
+    const char *start = strstr(body, anchor);
+    if (start == NULL) {
+        return false;
+    }
+    start += strlen(anchor);
+
+    const char *end = strchr(start, '"');
+    if (end == NULL || (size_t)(end - start) >= len) {
+        return false;
+    }
+
+    memcpy(buf, start, end - start);
+    buf[end - start] = '\0';
+    return true;
+}
+
+bool parse_hostname(const char *body, char *buf, size_t len) {
+    return copy_quoted_value(body, "\"hostname\":\"", buf, len);
+}
+
+bool parse_wifi_credentials(const char *body, char *ssid, size_t ssid_len,
+                            char *pass, size_t pass_len) {
+    return copy_quoted_value(body, "\"ssid\":\"", ssid, ssid_len) &&
+           copy_quoted_value(body, "\"pass\":\"", pass, pass_len);
+}
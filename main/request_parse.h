@@ -0,0 +1,43 @@
+#ifndef REQUEST_PARSE_H
+#define REQUEST_PARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Pure parsing of the simple JSON request bodies accepted by the HTTP
+// handlers. Split out of main.c so the host-side harness can test and
+// benchmark the parsing without hardware. These are deliberately the same
+// lightweight substring parsers the handlers always used, not a full JSON
+// parser.
+
+// {"state":"on"} / {"state":"off"} -> 1 / 0, anything else -> -1
+int parse_relay_state(const char *body);
+
+// {"enabled":bool,"onDuration":n,"offDuration":n}; absent fields are -1
+typedef struct {
+    int enabled;            // -1 absent, else 0/1
+    long on_duration_s;     // -1 absent
+    long off_duration_s;    // -1 absent
+} timer_request_t;
+
+void parse_timer_request(const char *body, timer_request_t *out);
+
+// Humidity controller update; absent fields are -1 so callers can apply
+// partial updates, mirroring timer_request_t
+typedef struct {
+    int enabled;            // 1 / 0 / -1 (absent)
+    double threshold;       // percent RH, -1 when absent
+    long on_time_s;         // -1 when absent
+    long cooldown_s;        // -1 when absent
+} humidity_ctl_request_t;
+
+void parse_humidity_ctl_request(const char *body, humidity_ctl_request_t *out);
+
+// {"hostname":"..."} -> copies the value into buf, returns true on success
+bool parse_hostname(const char *body, char *buf, size_t len);
+
+// {"ssid":"...","pass":"..."} -> copies both values, returns true on success
+bool parse_wifi_credentials(const char *body, char *ssid, size_t ssid_len,
+                            char *pass, size_t pass_len);
+
+#endif // REQUEST_PARSE_H
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include "schedule.h"
+
+static bool window_active(const schedule_entry_t *entry, int minute_of_day) {
+    if (minute_of_day < 0) {
+        return false;   // wall clock not synced yet
+    }
+    if (entry->start_min <= entry->end_min) {
+        return minute_of_day >= entry->start_min && minute_of_day < entry->end_min;
+    }
+    // Wraps midnight, e.g. 22:00..06:00
+    return minute_of_day >= entry->start_min || minute_of_day < entry->end_min;
+}
+
+static bool interval_active(const schedule_entry_t *entry, uint32_t uptime_s) {
+    if (entry->period_s == 0) {
+        return false;
+    }
+    return (uptime_s % entry->period_s) < entry->duration_s;
+}
+
+bool schedule_evaluate(const schedule_t *schedule, int minute_of_day,
+                       uint32_t uptime_s) {
+    for (int i = 0; i < schedule->count; i++) {
+        const schedule_entry_t *entry = &schedule->entries[i];
+        if (!entry->enabled) {
+            continue;
+        }
+        if (entry->type == SCHEDULE_ENTRY_WINDOW) {
+            if (window_active(entry, minute_of_day)) {
+                return true;
+            }
+        } else if (interval_active(entry, uptime_s)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Numeric field inside one entry segment, or fallback when absent
+static long entry_field(const char *segment, const char *anchor, long fallback) {
+    const char *found = strstr(segment, anchor);
+    if (found == NULL) {
+        return fallback;
+    }
+    return atol(found + strlen(anchor));
+}
+
+// Parse one {...} entry segment (already NUL-terminated)
+static bool parse_entry(const char *segment, schedule_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->enabled = strstr(segment, "\"enabled\":false") == NULL;
+
+    if (strstr(segment, "\"type\":\"window\"")) {
+        entry->type = SCHEDULE_ENTRY_WINDOW;
+        long start = entry_field(segment, "\"start\":", -1);
+        long end = entry_field(segment, "\"end\":", -1);
+        if (start < 0 || start > 1439 || end < 0 || end > 1439) {
+            return false;
+        }
+        entry->start_min = (uint16_t)start;
+        entry->end_min = (uint16_t)end;
+        return true;
+    }
+
+    if (strstr(segment, "\"type\":\"interval\"")) {
+        entry->type = SCHEDULE_ENTRY_INTERVAL;
+        long period = entry_field(segment, "\"period\":", 0);
+        long duration = entry_field(segment, "\"duration\":", 0);
+        if (period <= 0 || duration < 0 || duration > period) {
+            return false;
+        }
+        entry->period_s = (uint32_t)period;
+        entry->duration_s = (uint32_t)duration;
+        return true;
+    }
+
+    return false;
+}
+
+bool schedule_parse(const char *body, schedule_t *out) {
+    memset(out, 0, sizeof(*out));
+
+    const char *cursor = strstr(body, "\"entries\":[");
+    if (cursor == NULL) {
+        return false;
+    }
+    cursor += strlen("\"entries\":[");
+
+    while (1) {
+        const char *open = strchr(cursor, '{');
+        const char *close_bracket = strchr(cursor, ']');
+        if (open == NULL || (close_bracket != NULL && close_bracket < open)) {
+            break;  // end of the array
+        }
+        const char *close = strchr(open, '}');
+        if (close == NULL) {
+            return false;
+        }
+
+        char segment[128];
+        size_t len = close - open + 1;
+        if (len >= sizeof(segment)) {
+            return false;
+        }
+        memcpy(segment, open, len);
+        segment[len] = '\0';
+
+        if (out->count == SCHEDULE_MAX_ENTRIES) {
+            return false;
+        }
+        if (!parse_entry(segment, &out->entries[out->count])) {
+            return false;
+        }
+        out->count++;
+        cursor = close + 1;
+    }
+
+    return true;
+}
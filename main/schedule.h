@@ -0,0 +1,58 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Relay schedule engine. The collector used to drive timed relay cycles
+// remotely (two HTTP round trips per toggle per node); entries are now
+// stored and evaluated on-device, and the collector only syncs the
+// schedule occasionally.
+//
+// Two entry kinds:
+//  - window: relay on between two minutes-of-day (wall clock via SNTP;
+//    a window wraps midnight when end < start). Skipped until the clock
+//    has synced.
+//  - interval: relay on for duration_s out of every period_s, phased
+//    from boot. Needs no wall clock.
+//
+// The evaluation is pure (no IDF dependencies beyond esp_err.h) so it is
+// exercised by the host test harness like dht_decode and request_parse.
+
+#define SCHEDULE_MAX_ENTRIES 8
+
+typedef enum {
+    SCHEDULE_ENTRY_WINDOW = 0,
+    SCHEDULE_ENTRY_INTERVAL = 1,
+} schedule_entry_type_t;
+
+typedef struct {
+    bool enabled;
+    uint8_t type;           // schedule_entry_type_t
+    uint16_t start_min;     // window: minutes since midnight, 0..1439
+    uint16_t end_min;       // window: minutes since midnight, 0..1439
+    uint32_t period_s;      // interval: cycle length
+    uint32_t duration_s;    // interval: on-time per cycle
+} schedule_entry_t;
+
+typedef struct {
+    uint8_t count;
+    schedule_entry_t entries[SCHEDULE_MAX_ENTRIES];
+} schedule_t;
+
+// Desired relay state: true when any enabled entry is active.
+// minute_of_day is -1 while the wall clock is unsynced, which skips
+// window entries; uptime_s phases interval entries.
+bool schedule_evaluate(const schedule_t *schedule, int minute_of_day,
+                       uint32_t uptime_s);
+
+// Parse a full schedule replacement from a request body of the form
+// {"entries":[{"type":"window","start":390,"end":1080},
+//             {"type":"interval","period":3600,"duration":120}]}
+// Times are minutes since midnight. Entries beyond SCHEDULE_MAX_ENTRIES
+// are rejected, as are entries with a missing type or a zero period.
+bool schedule_parse(const char *body, schedule_t *out);
+
+#endif // SCHEDULE_H
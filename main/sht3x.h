@@ -0,0 +1,20 @@
+#ifndef SHT3X_H
+#define SHT3X_H
+
+#include "esp_err.h"
+
+// Minimal SHT3x (SHT30/31/35) driver over the I2C master bus. Unlike the
+// DHT single-wire protocol there is no microsecond timing in software: a
+// measurement is two millisecond-scale I2C transactions handled by the
+// peripheral, so reads never mask interrupts and can run at 1 Hz or more.
+
+// Bring up the I2C bus and probe the sensor. Pins and address come from
+// menuconfig (SHT3X_* options).
+esp_err_t sht3x_init(void);
+
+// Trigger one single-shot, high-repeatability measurement and convert it.
+// Blocks the calling task for the ~15 ms measurement time.
+// Returns ESP_ERR_INVALID_CRC if either word fails its checksum.
+esp_err_t sht3x_read(float *temperature, float *humidity);
+
+#endif // SHT3X_H
@@ -0,0 +1,14 @@
+// Minimal esp_err.h stand-in so the pure application modules build on a
+// Linux host (same approach as the mdns test_afl_fuzz_host harness).
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_CRC     0x109
+#define ESP_ERR_TIMEOUT         0x107
+#define ESP_ERR_NOT_FOUND       0x105
+
+#endif // ESP_ERR_H
@@ -0,0 +1,284 @@
+// Host-side correctness tests and microbenchmarks for the pure application
+// logic: DHT payload decode, HTTP request parsing and JSON serialization.
+// Build and run on a PC with `make run`; `make bench` prints ns-per-op for
+// the hot paths so regressions show up in seconds, not on a bench with a
+// logic analyzer.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dht_decode.h"
+#include "request_parse.h"
+#include "schedule.h"
+#include "json_writer.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b) CHECK((a) - (b) < 0.001f && (b) - (a) < 0.001f)
+
+static void test_dht_decode(void) {
+    float temperature, humidity;
+
+    // 65.2 %RH, 23.5 C (values from the DHT22 datasheet example)
+    uint8_t frame[5] = {0x02, 0x8C, 0x00, 0xEB, (0x02 + 0x8C + 0x00 + 0xEB) & 0xFF};
+    CHECK(dht_decode_payload(frame, &temperature, &humidity) == ESP_OK);
+    CHECK_NEAR(humidity, 65.2f);
+    CHECK_NEAR(temperature, 23.5f);
+
+    // Negative temperature: sign bit set in byte 2
+    uint8_t cold[5] = {0x01, 0x90, 0x80, 0x65, (0x01 + 0x90 + 0x80 + 0x65) & 0xFF};
+    CHECK(dht_decode_payload(cold, &temperature, &humidity) == ESP_OK);
+    CHECK_NEAR(temperature, -10.1f);
+
+    // Corrupted checksum
+    frame[4] ^= 0xFF;
+    CHECK(dht_decode_payload(frame, &temperature, &humidity) == ESP_ERR_INVALID_CRC);
+}
+
+static void test_request_parse(void) {
+    CHECK(parse_relay_state("{\"state\":\"on\"}") == 1);
+    CHECK(parse_relay_state("{\"state\":\"off\"}") == 0);
+    CHECK(parse_relay_state("{\"state\":\"maybe\"}") == -1);
+    CHECK(parse_relay_state("") == -1);
+
+    timer_request_t timer;
+    parse_timer_request("{\"enabled\":true,\"onDuration\":30,\"offDuration\":90}", &timer);
+    CHECK(timer.enabled == 1);
+    CHECK(timer.on_duration_s == 30);
+    CHECK(timer.off_duration_s == 90);
+
+    parse_timer_request("{\"enabled\":false}", &timer);
+    CHECK(timer.enabled == 0);
+    CHECK(timer.on_duration_s == -1);
+    CHECK(timer.off_duration_s == -1);
+
+    humidity_ctl_request_t humid;
+    parse_humidity_ctl_request(
+        "{\"enabled\":true,\"threshold\":65.5,\"onTime\":120,\"cooldown\":300}", &humid);
+    CHECK(humid.enabled == 1);
+    CHECK(humid.threshold > 65.4 && humid.threshold < 65.6);
+    CHECK(humid.on_time_s == 120);
+    CHECK(humid.cooldown_s == 300);
+
+    parse_humidity_ctl_request("{\"threshold\":70}", &humid);
+    CHECK(humid.enabled == -1);
+    CHECK(humid.threshold == 70);
+    CHECK(humid.on_time_s == -1);
+    CHECK(humid.cooldown_s == -1);
+
+    char hostname[32];
+    CHECK(parse_hostname("{\"hostname\":\"incubator-3\"}", hostname, sizeof(hostname)));
+    CHECK(strcmp(hostname, "incubator-3") == 0);
+    CHECK(!parse_hostname("{\"name\":\"nope\"}", hostname, sizeof(hostname)));
+
+    // Value longer than the destination buffer must be rejected, not truncated
+    char small[4];
+    CHECK(!parse_hostname("{\"hostname\":\"too-long\"}", small, sizeof(small)));
+
+    char ssid[33], pass[65];
+    CHECK(parse_wifi_credentials("{\"ssid\":\"lab\",\"pass\":\"secret\"}",
+                                 ssid, sizeof(ssid), pass, sizeof(pass)));
+    CHECK(strcmp(ssid, "lab") == 0);
+    CHECK(strcmp(pass, "secret") == 0);
+    CHECK(!parse_wifi_credentials("{\"ssid\":\"lab\"}",
+                                  ssid, sizeof(ssid), pass, sizeof(pass)));
+}
+
+static void test_schedule(void) {
+    schedule_t sched;
+
+    CHECK(schedule_parse(
+        "{\"entries\":[{\"type\":\"window\",\"start\":390,\"end\":1080},"
+        "{\"type\":\"interval\",\"period\":3600,\"duration\":120}]}", &sched));
+    CHECK(sched.count == 2);
+    CHECK(sched.entries[0].type == SCHEDULE_ENTRY_WINDOW);
+    CHECK(sched.entries[0].enabled);
+    CHECK(sched.entries[0].start_min == 390 && sched.entries[0].end_min == 1080);
+    CHECK(sched.entries[1].type == SCHEDULE_ENTRY_INTERVAL);
+    CHECK(sched.entries[1].period_s == 3600 && sched.entries[1].duration_s == 120);
+
+    // Window active strictly inside [start, end)
+    sched.count = 1;
+    CHECK(!schedule_evaluate(&sched, 389, 0));
+    CHECK(schedule_evaluate(&sched, 390, 0));
+    CHECK(schedule_evaluate(&sched, 1079, 0));
+    CHECK(!schedule_evaluate(&sched, 1080, 0));
+    // Unsynced clock skips window entries
+    CHECK(!schedule_evaluate(&sched, -1, 0));
+
+    // Overnight window wraps midnight
+    sched.entries[0].start_min = 1320;  // 22:00
+    sched.entries[0].end_min = 360;     // 06:00
+    CHECK(schedule_evaluate(&sched, 1380, 0));
+    CHECK(schedule_evaluate(&sched, 120, 0));
+    CHECK(!schedule_evaluate(&sched, 720, 0));
+
+    // Interval phase from uptime
+    schedule_t ivl;
+    CHECK(schedule_parse(
+        "{\"entries\":[{\"type\":\"interval\",\"period\":60,\"duration\":10}]}", &ivl));
+    CHECK(schedule_evaluate(&ivl, -1, 0));
+    CHECK(schedule_evaluate(&ivl, -1, 9));
+    CHECK(!schedule_evaluate(&ivl, -1, 10));
+    CHECK(schedule_evaluate(&ivl, -1, 60));
+
+    // Disabled entries never fire
+    ivl.entries[0].enabled = false;
+    CHECK(!schedule_evaluate(&ivl, -1, 0));
+
+    // Empty schedule and malformed bodies
+    CHECK(schedule_parse("{\"entries\":[]}", &sched));
+    CHECK(sched.count == 0);
+    CHECK(!schedule_parse("{}", &sched));
+    CHECK(!schedule_parse("{\"entries\":[{\"start\":1}]}", &sched));
+    CHECK(!schedule_parse(
+        "{\"entries\":[{\"type\":\"interval\",\"period\":0,\"duration\":0}]}", &sched));
+    CHECK(!schedule_parse(
+        "{\"entries\":[{\"type\":\"window\",\"start\":1500,\"end\":10}]}", &sched));
+}
+
+// Flush callback collecting writer output into one buffer
+static char sink[4096];
+static size_t sink_len;
+
+static esp_err_t sink_flush(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    memcpy(sink + sink_len, data, len);
+    sink_len += len;
+    sink[sink_len] = '\0';
+    return ESP_OK;
+}
+
+// Flush callback that rejects everything after the first chunk
+static esp_err_t failing_flush(void *ctx, const char *data, size_t len) {
+    (void)ctx; (void)data; (void)len;
+    static int calls;
+    return (calls++ == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static void test_json_writer(void) {
+    json_writer_t jw;
+
+    sink_len = 0;
+    json_writer_init(&jw, sink_flush, NULL);
+    json_writer_object_begin(&jw);
+    json_writer_float1(&jw, "temperature", 23.5f);
+    json_writer_uint(&jw, "age", 12);
+    json_writer_bool(&jw, "ok", true);
+    json_writer_object_end(&jw);
+    CHECK(json_writer_finish(&jw) == ESP_OK);
+    CHECK(strcmp(sink, "{\"temperature\":23.5,\"age\":12,\"ok\":true}") == 0);
+
+    // Escaping: quotes, backslashes and control bytes in SSIDs
+    sink_len = 0;
+    json_writer_init(&jw, sink_flush, NULL);
+    json_writer_object_begin(&jw);
+    json_writer_array_begin(&jw, "networks");
+    json_writer_string(&jw, NULL, "plain");
+    json_writer_string(&jw, NULL, "evil\"ssid\\x\n");
+    json_writer_array_end(&jw);
+    json_writer_object_end(&jw);
+    CHECK(json_writer_finish(&jw) == ESP_OK);
+    CHECK(strcmp(sink,
+        "{\"networks\":[\"plain\",\"evil\\\"ssid\\\\x\\u000a\"]}") == 0);
+
+    // Output larger than the scratch buffer must flush through cleanly
+    sink_len = 0;
+    json_writer_init(&jw, sink_flush, NULL);
+    json_writer_array_begin(&jw, NULL);
+    for (int i = 0; i < 100; i++) {
+        json_writer_uint(&jw, NULL, i);
+    }
+    json_writer_array_end(&jw);
+    CHECK(json_writer_finish(&jw) == ESP_OK);
+    CHECK(sink[0] == '[' && sink[sink_len - 1] == ']');
+    CHECK(strstr(sink, "0,1,2,") != NULL);
+    CHECK(strstr(sink, ",98,99]") != NULL);
+
+    // A failing flush (client gone mid-response) must make the writer
+    // discard output, not overrun its buffer as the response continues
+    sink_len = 0;
+    json_writer_init(&jw, failing_flush, NULL);
+    json_writer_array_begin(&jw, NULL);
+    for (int i = 0; i < 1000; i++) {
+        json_writer_uint(&jw, NULL, i);
+    }
+    json_writer_array_end(&jw);
+    CHECK(json_writer_finish(&jw) == ESP_FAIL);
+}
+
+static double bench_ns_per_op(void (*op)(void), int iterations) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; i++) {
+        op();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return ns / iterations;
+}
+
+static void bench_decode_op(void) {
+    static const uint8_t frame[5] = {0x02, 0x8C, 0x00, 0xEB, 0x79};
+    float temperature, humidity;
+    dht_decode_payload(frame, &temperature, &humidity);
+}
+
+static void bench_parse_op(void) {
+    timer_request_t timer;
+    parse_timer_request("{\"enabled\":true,\"onDuration\":30,\"offDuration\":90}", &timer);
+}
+
+static esp_err_t null_flush(void *ctx, const char *data, size_t len) {
+    (void)ctx; (void)data; (void)len;
+    return ESP_OK;
+}
+
+static void bench_serialize_op(void) {
+    json_writer_t jw;
+    json_writer_init(&jw, null_flush, NULL);
+    json_writer_object_begin(&jw);
+    json_writer_float1(&jw, "temperature", 23.5f);
+    json_writer_float1(&jw, "humidity", 65.2f);
+    json_writer_uint(&jw, "age", 12);
+    json_writer_string(&jw, "status", "ok");
+    json_writer_object_end(&jw);
+    json_writer_finish(&jw);
+}
+
+static void run_benchmarks(void) {
+    printf("dht_decode_payload:      %8.1f ns/frame\n",
+           bench_ns_per_op(bench_decode_op, 1000000));
+    printf("parse_timer_request:     %8.1f ns/request\n",
+           bench_ns_per_op(bench_parse_op, 1000000));
+    printf("sensor response (json):  %8.1f ns/response\n",
+           bench_ns_per_op(bench_serialize_op, 1000000));
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmarks();
+        return 0;
+    }
+
+    test_dht_decode();
+    test_request_parse();
+    test_json_writer();
+    test_schedule();
+
+    if (failures == 0) {
+        printf("All tests passed\n");
+        return 0;
+    }
+    printf("%d check(s) failed\n", failures);
+    return 1;
+}